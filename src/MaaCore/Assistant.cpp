@@ -6,6 +6,8 @@
 
 #include "Config/GeneralConfig.h"
 #include "Config/ResourceLoader.h"
+#include "Config/TaskData.h"
+#include "Config/TemplResource.h"
 #include "Controller/Controller.h"
 #include "Status.h"
 #include "Task/Interface/AwardTask.h"
@@ -136,6 +138,16 @@ bool asst::Assistant::set_instance_option(InstanceOptionKey key, const std::stri
             return true;
         }
         break;
+    case InstanceOptionKey::ContinuousScreencap:
+        if (constexpr std::string_view Enable = "1"; value == Enable) {
+            m_ctrler->set_continuous_screencap(true);
+            return true;
+        }
+        else if (constexpr std::string_view Disable = "0"; value == Disable) {
+            m_ctrler->set_continuous_screencap(false);
+            return true;
+        }
+        break;
     default:
         break;
     }
@@ -175,6 +187,52 @@ bool asst::Assistant::ctrl_screencap()
     return m_ctrler->screencap();
 }
 
+void asst::Assistant::preload_templs()
+{
+    const int limit_mb = Config.get_options().templ_preload_memory_limit;
+    if (limit_mb <= 0) {
+        return;
+    }
+    // 上一次的还没加载完，不重复加载
+    if (m_preload_future.valid() && m_preload_future.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+        return;
+    }
+
+    std::vector<std::string> entries;
+    for (const auto& task_ptr : m_tasks_list | views::values) {
+        if (!task_ptr->get_enable()) {
+            continue;
+        }
+        auto task_entries = task_ptr->get_entry_tasks();
+        entries.insert(entries.end(), std::make_move_iterator(task_entries.begin()),
+                       std::make_move_iterator(task_entries.end()));
+    }
+    std::vector<std::string> templs = Task.get_reachable_templs(entries);
+    Log.info(__FUNCTION__, "| entries:", entries.size(), "templs:", templs.size());
+    if (templs.empty()) {
+        return;
+    }
+
+    const size_t memory_limit = static_cast<size_t>(limit_mb) * 1024 * 1024;
+    m_preload_future = std::async(std::launch::async, [this, templs = std::move(templs), memory_limit]() {
+        const auto start_time = std::chrono::steady_clock::now();
+        size_t count = 0;
+        for (const std::string& name : templs) {
+            if (m_thread_exit) {
+                return;
+            }
+            if (!TemplResource::get_instance().preload(name, memory_limit)) {
+                Log.info("preload templs | memory limit reached");
+                break;
+            }
+            ++count;
+        }
+        const auto cost = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() -
+                                                                                start_time);
+        Log.info("preload templs | done", count, "/", templs.size(), ", cost", cost.count(), "ms");
+    });
+}
+
 asst::Assistant::TaskId asst::Assistant::append_task(const std::string& type, const std::string& params)
 {
     Log.info(__FUNCTION__, type, params);
@@ -340,6 +398,10 @@ bool asst::Assistant::start(bool block)
     if (block) { // 外部调用
         lock = std::unique_lock<std::mutex>(m_mutex);
     }
+    // 遍历任务图时会顺便生成任务，TaskData 内部有锁，其他实例的工作线程同时在跑也没关系
+    // 放在唤醒工作线程之前，是为了让预加载赶在第一次识别之前开始
+    preload_templs();
+
     m_thread_idle = false;
     m_running = true;
     m_condvar.notify_one();
@@ -404,6 +466,10 @@ void Assistant::working_proc()
         bool ret = task_ptr->run();
         finished_tasks.emplace_back(id);
 
+        const auto templ_stats = TemplResource::get_instance().get_stats();
+        Log.info("templ cache | hits:", templ_stats.hits, "misses:", templ_stats.misses,
+                 "evictions:", templ_stats.evictions, "bytes:", templ_stats.bytes);
+
         lock.lock();
         if (!m_tasks_list.empty()) {
             m_tasks_list.pop_front();
@@ -144,6 +144,8 @@ namespace asst
         bool ctrl_connect(const std::string& adb_path, const std::string& address, const std::string& config);
         bool ctrl_click(int x, int y);
         bool ctrl_screencap();
+        // 在后台预先加载任务列表接下来可能用到的模板
+        void preload_templs();
 
         std::string m_uuid;
 
@@ -177,5 +179,6 @@ namespace asst
         std::thread m_msg_thread;
         std::thread m_call_thread;
         std::thread m_working_thread;
+        std::future<void> m_preload_future;
     };
 } // namespace asst
@@ -3,6 +3,7 @@
 #include <climits>
 #include <cmath>
 #include <functional>
+#include <memory>
 #include <ostream>
 #include <string>
 #include <unordered_map>
@@ -37,6 +38,7 @@ namespace asst
         DeploymentWithPause = 3, // 自动战斗、肉鸽、保全 是否使用 暂停下干员， "0" | "1"
         AdbLiteEnabled = 4,      // 是否使用 AdbLite， "0" | "1"
         KillAdbOnExit = 5,       // 退出时是否杀掉 Adb 进程， "0" | "1"
+        ContinuousScreencap = 6, // 是否在后台线程持续截图， "0" | "1"
     };
 
     enum class TouchMode
@@ -383,6 +385,8 @@ namespace asst
         bool full_match = false;       // 是否需要全匹配，否则搜索到子串就算匹配上了
         bool is_ascii = false;         // 是否启用字符数字模型
         bool without_det = false;      // 是否不使用检测模型
+        bool use_ocr_cache = false;    // 是否缓存识别结果，像素完全相同的 roi 直接复用上次的结果
+        bool use_digit_ocr = false;    // 是否先用快速数字识别，认不出来再用 OCR（仅 withoutDet 时有效）
         bool replace_full = false; // 匹配之后，是否将整个字符串replace（false是只替换match的部分）
         std::vector<std::pair<std::string, std::string>>
             replace_map; // 部分文字容易识别错，字符串强制replace之后，再进行匹配
@@ -400,8 +404,12 @@ namespace asst
         std::vector<std::string> templ_names; // 匹配模板图片文件名
         std::vector<double> templ_thresholds; // 模板匹配阈值
         std::pair<int, int> mask_range;       // 掩码的二值化范围
+        int pyramid_levels = 0;               // 由粗到精匹配时图像缩小的层数（每层缩小一半），0 为不启用
+        double pyramid_tolerance = 0.1;       // 粗匹配时阈值放宽的量，得分不低于 阈值 - 该值 的位置会在原图上精确匹配
     };
 
+    class HashIndex;
+
     // hash 计算任务的信息
     struct HashTaskInfo : public TaskInfo
     {
@@ -412,6 +420,7 @@ namespace asst
         HashTaskInfo& operator=(const HashTaskInfo&) = default;
         HashTaskInfo& operator=(HashTaskInfo&&) noexcept = default;
         std::vector<std::string> hashes; // 需要多个哈希值
+        std::shared_ptr<const HashIndex> hash_index; // hashes 加载时建好的索引，各个 Hasher 共用
         int dist_threshold = 0;          // 汉明距离阈值
         std::pair<int, int> mask_range;  // 掩码的二值化范围
         bool bound = false;              // 是否裁剪周围黑边
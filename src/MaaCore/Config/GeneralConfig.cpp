@@ -12,6 +12,13 @@ bool asst::GeneralConfig::parse(const json::value& json)
     {
         const json::value& options_json = json.at("options");
         m_options.task_delay = options_json.at("taskDelay").as_integer();
+        m_options.adaptive_delay = options_json.get("adaptiveDelay", false);
+        m_options.delay_calibration = options_json.get("delayCalibration", false);
+        m_options.delay_calibration_reference = options_json.get("delayCalibrationReference", 300);
+        m_options.pipeline_analyze_threads = options_json.get("pipelineAnalyzeThreads", 1);
+        m_options.battlefield_analyze_threads = options_json.get("battlefieldAnalyzeThreads", 1);
+        m_options.templ_cache_memory_limit = options_json.get("templCacheMemoryLimit", 0);
+        m_options.templ_preload_memory_limit = options_json.get("templPreloadMemoryLimit", 0);
         m_options.control_delay_lower = options_json.at("controlDelayRange")[0].as_integer();
         m_options.control_delay_upper = options_json.at("controlDelayRange")[1].as_integer();
         // m_options.print_window = options_json.at("printWindow").as_boolean();
@@ -77,6 +84,7 @@ bool asst::GeneralConfig::parse(const json::value& json)
         adb.screencap_raw_by_nc = cfg_json.get("screencapRawByNC", base_cfg.screencap_raw_by_nc);
         adb.nc_address = cfg_json.get("ncAddress", base_cfg.nc_address);
         adb.screencap_encode = cfg_json.get("screencapEncode", base_cfg.screencap_encode);
+        adb.screencap_raw_by_stream = cfg_json.get("screencapRawByStream", base_cfg.screencap_raw_by_stream);
         adb.release = cfg_json.get("release", base_cfg.release);
         adb.start = cfg_json.get("start", base_cfg.start);
         adb.stop = cfg_json.get("stop", base_cfg.stop);
@@ -32,6 +32,13 @@ namespace asst
     struct Options
     {
         int task_delay = 0;          // 任务间延时：越快操作越快，但会增加CPU消耗
+        bool adaptive_delay = false; // 自适应延时：画面稳定或下一步已能识别到时提前结束延时，配置的延时作为上限
+        bool delay_calibration = false; // 按设备实测的操作延迟缩放各种延时，延迟档案按设备保存
+        int delay_calibration_reference = 300; // 任务里配置的延时所对应的操作延迟，单位毫秒
+        int pipeline_analyze_threads = 1; // 并行识别 next 中模板匹配任务的线程数，不大于 1 时逐个识别
+        int battlefield_analyze_threads = 1; // 战斗中并行识别各项信息、各个干员卡片的线程数，不大于 1 时逐个识别
+        int templ_cache_memory_limit = 0; // 已加载模板的内存上限，单位 MB，超出时淘汰最久没用过的，0 为不限制
+        int templ_preload_memory_limit = 0; // 开始任务时预先加载模板的内存上限，单位 MB，0 为不预先加载
         int control_delay_lower = 0; // 点击随机延时下限：每次点击操作会进行随机延时
         int control_delay_upper = 0; // 点击随机延时上限：每次点击操作会进行随机延时
         // bool print_window = false;// 截图功能：开启后每次结算界面会截图到screenshot目录下
@@ -71,6 +78,7 @@ namespace asst
         std::string screencap_raw_by_nc;
         std::string nc_address;
         std::string screencap_encode;
+        std::string screencap_raw_by_stream;
         std::string release;
         std::string start;
         std::string stop;
@@ -4,6 +4,7 @@
 #include "BattleDataConfig.h"
 #include "Utils/ImageIo.hpp"
 #include "Utils/Logger.hpp"
+#include "Utils/NoWarningCV.h"
 
 bool asst::AvatarCacheManager::load(const std::filesystem::path& path)
 {
@@ -52,9 +53,12 @@ void asst::AvatarCacheManager::set_avatar(const std::string& name, battle::Role
 
     if (overlay) {
         m_avatars[role].insert_or_assign(name, avatar);
+        m_descriptors[role].insert_or_assign(name, make_descriptor(avatar));
     }
     else {
-        m_avatars[role].try_emplace(name, avatar);
+        if (m_avatars[role].try_emplace(name, avatar).second) {
+            m_descriptors[role].insert_or_assign(name, make_descriptor(avatar));
+        }
         return;
     }
 
@@ -97,7 +101,60 @@ void asst::AvatarCacheManager::_load(LoadItem waiting_to_load)
                 continue;
             }
 
+            m_descriptors[role].insert_or_assign(name, make_descriptor(avatar));
             m_avatars[role].insert_or_assign(name, std::move(avatar));
         }
     }
 }
+
+asst::AvatarCacheManager::AvatarCandidates asst::AvatarCacheManager::get_avatar_candidates(battle::Role role,
+                                                                                          const cv::Mat& avatar,
+                                                                                          size_t max_count)
+{
+    // 等待后台加载完成
+    std::unique_lock<std::mutex> lock(m_load_mutex);
+
+    const auto& descriptors = m_descriptors[role];
+    if (descriptors.empty() || avatar.empty()) {
+        return {};
+    }
+
+    const cv::Mat desc = make_descriptor(avatar);
+    std::vector<std::pair<double, const std::string*>> scores;
+    scores.reserve(descriptors.size());
+    for (const auto& [name, templ_desc] : descriptors) {
+        scores.emplace_back(desc.dot(templ_desc), &name);
+    }
+
+    // 多排一个出来，作为没入选的头像里得分最高的
+    const size_t count = std::min(max_count, scores.size());
+    const size_t sorted_count = std::min(max_count + 1, scores.size());
+    std::partial_sort(scores.begin(), scores.begin() + sorted_count, scores.end(),
+                      [](const auto& lhs, const auto& rhs) { return lhs.first > rhs.first; });
+
+    AvatarCandidates candidates;
+    candidates.names.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        candidates.names.emplace_back(*scores[i].second);
+    }
+    if (sorted_count > count) {
+        candidates.rest_score = scores[count].first;
+    }
+    return candidates;
+}
+
+cv::Mat asst::AvatarCacheManager::make_descriptor(const cv::Mat& avatar)
+{
+    static constexpr int DescriptorSize = 12;
+
+    cv::Mat thumb;
+    cv::resize(avatar, thumb, cv::Size(DescriptorSize, DescriptorSize), 0, 0, cv::INTER_AREA);
+    cv::Mat desc;
+    thumb.reshape(1, 1).convertTo(desc, CV_32F);
+    desc -= cv::mean(desc)[0];
+    const double norm = cv::norm(desc);
+    if (norm > 0) {
+        desc /= norm;
+    }
+    return desc;
+}
@@ -5,6 +5,7 @@
 
 #include <future>
 #include <unordered_map>
+#include <vector>
 
 #include "Utils/NoWarningCVMat.h"
 
@@ -19,6 +20,12 @@ namespace asst
         using AvatarsMap = std::unordered_map<std::string, cv::Mat>;
         inline static const std::string CacheExtension = ".png";
 
+        struct AvatarCandidates
+        {
+            std::vector<std::string> names; // 由高到低排序
+            double rest_score = -1.0;       // 没入选的头像里最高的粗筛得分，全部入选时为 -1
+        };
+
     public:
         virtual ~AvatarCacheManager() override = default;
 
@@ -26,16 +33,22 @@ namespace asst
 
         const AvatarsMap& get_avatars(battle::Role role);
         void set_avatar(const std::string& name, battle::Role role, const cv::Mat& avatar, bool overlay = true);
+        // 用缩略图的相关系数粗筛，返回与 avatar 最像的至多 max_count 个头像名
+        AvatarCandidates get_avatar_candidates(battle::Role role, const cv::Mat& avatar, size_t max_count);
 
     private:
         using LoadItem = std::unordered_map<battle::Role, std::unordered_map<std::string, std::filesystem::path>>;
         void _load(LoadItem waiting_to_load);
 
+        // 12x12 的缩略图，去均值后归一化，两个描述子的点积近似于原图的 TM_CCOEFF_NORMED 得分
+        static cv::Mat make_descriptor(const cv::Mat& avatar);
+
         std::filesystem::path m_save_path;
         std::future<void> m_load_future;
         std::mutex m_load_mutex;
 
         std::unordered_map<battle::Role, std::unordered_map<std::string, cv::Mat>> m_avatars;
+        std::unordered_map<battle::Role, std::unordered_map<std::string, cv::Mat>> m_descriptors;
     };
     inline static auto& AvatarCache = AvatarCacheManager::get_instance();
 }
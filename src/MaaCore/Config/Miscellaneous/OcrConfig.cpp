@@ -3,6 +3,7 @@
 #include <meojson/json.hpp>
 
 #include "Utils/Logger.hpp"
+#include "Utils/StringMisc.hpp"
 
 std::string asst::OcrConfig::process_equivalence_class(const std::string& str) const
 {
@@ -15,11 +16,73 @@ std::string asst::OcrConfig::process_equivalence_class(const std::string& str) c
     return result;
 }
 
+std::shared_ptr<const asst::OcrReplacer>
+    asst::OcrConfig::get_replacer(const std::vector<std::pair<std::string, std::string>>& replace)
+{
+    // '\0' 不会出现在规则里，用来分隔
+    std::string key;
+    for (const auto& [pattern, new_str] : replace) {
+        key.append(pattern).push_back('\0');
+        key.append(new_str).push_back('\0');
+    }
+
+    std::unique_lock<std::mutex> lock(m_compiled_mutex);
+    if (auto iter = m_replacers.find(key); iter != m_replacers.end()) {
+        return iter->second;
+    }
+
+    std::vector<std::pair<std::string, std::string>> processed;
+    processed.reserve(replace.size());
+    for (const auto& [pattern, new_str] : replace) {
+        // do not create new_val as val is user-provided, and can avoid issues like 夕 and katakana タ
+        processed.emplace_back(process_equivalence_class(pattern), new_str);
+    }
+    auto replacer = std::make_shared<const OcrReplacer>(processed);
+
+    if (m_replacers.size() >= CompiledCacheCapacity) {
+        m_replacers.clear();
+    }
+    m_replacers.emplace(std::move(key), replacer);
+    return replacer;
+}
+
+std::shared_ptr<const asst::OcrRequiredMatcher>
+    asst::OcrConfig::get_required_matcher(const std::vector<std::string>& required)
+{
+    std::string key;
+    for (const std::string& text : required) {
+        key.append(text).push_back('\0');
+    }
+
+    std::unique_lock<std::mutex> lock(m_compiled_mutex);
+    if (auto iter = m_required_matchers.find(key); iter != m_required_matchers.end()) {
+        return iter->second;
+    }
+
+    std::vector<std::string> processed;
+    processed.reserve(required.size());
+    ranges::transform(required, std::back_inserter(processed),
+                      [&](const std::string& str) { return process_equivalence_class(str); });
+    auto matcher = std::make_shared<const OcrRequiredMatcher>(std::move(processed));
+
+    if (m_required_matchers.size() >= CompiledCacheCapacity) {
+        m_required_matchers.clear();
+    }
+    m_required_matchers.emplace(std::move(key), matcher);
+    return matcher;
+}
+
 bool asst::OcrConfig::parse(const json::value& json)
 {
     LogTraceFunction;
 
     m_eq_classes.clear();
+    {
+        // 等价类变了，之前编译好的规则都不能用了
+        std::unique_lock<std::mutex> lock(m_compiled_mutex);
+        m_replacers.clear();
+        m_required_matchers.clear();
+    }
 
     for (const json::value& eq_class : json.at("equivalence_classes").as_array()) {
         equivalence_class eq_class_tmp;
@@ -30,3 +93,49 @@ bool asst::OcrConfig::parse(const json::value& json)
     }
     return true;
 }
+
+asst::OcrReplacer::OcrReplacer(const std::vector<std::pair<std::string, std::string>>& replace)
+{
+    static constexpr std::string_view RegexSpecialChars = R"(\^$.|?*+()[]{})";
+    auto is_literal = [](const std::string& str) {
+        return str.find_first_of(RegexSpecialChars) == std::string::npos;
+    };
+
+    m_rules.reserve(replace.size());
+    for (const auto& [pattern, new_str] : replace) {
+        Rule rule { .pattern = pattern, .new_str = new_str, .regex = std::nullopt };
+        // 空串的 regex 语义比较特殊（每个字符之间都能匹配），仍然交给 std::regex；new_str 里的 $ 是 regex 的格式符
+        if (pattern.empty() || !is_literal(pattern) || new_str.find('$') != std::string::npos) {
+            rule.regex.emplace(pattern);
+        }
+        m_rules.emplace_back(std::move(rule));
+    }
+}
+
+void asst::OcrReplacer::apply(std::string& text, bool replace_full) const
+{
+    for (const Rule& rule : m_rules) {
+        if (replace_full) {
+            bool found = rule.regex ? std::regex_search(text, *rule.regex) : text.find(rule.pattern) != std::string::npos;
+            if (found) {
+                text = rule.new_str;
+            }
+        }
+        else if (rule.regex) {
+            text = std::regex_replace(text, *rule.regex, rule.new_str);
+        }
+        else {
+            utils::string_replace_all_in_place(text, rule.pattern, rule.new_str);
+        }
+    }
+}
+
+asst::OcrRequiredMatcher::OcrRequiredMatcher(std::vector<std::string> required)
+    : m_texts(std::move(required)), m_text_set(m_texts.begin(), m_texts.end()), m_automaton(m_texts)
+{}
+
+const std::string* asst::OcrRequiredMatcher::first_substring_of(std::string_view text) const
+{
+    auto index = m_automaton.first_pattern_in(text);
+    return index ? &m_texts.at(*index) : nullptr;
+}
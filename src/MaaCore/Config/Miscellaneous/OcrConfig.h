@@ -2,10 +2,16 @@
 
 #include "Config/AbstractConfig.h"
 
+#include "Utils/AhoCorasick.hpp"
 #include "Utils/Ranges.hpp"
 #include <algorithm>
+#include <memory>
+#include <mutex>
 #include <numeric>
+#include <optional>
+#include <regex>
 #include <string>
+#include <unordered_map>
 #include <unordered_set>
 #include <vector>
 
@@ -13,6 +19,47 @@
 
 namespace asst
 {
+    // 预编译好的 ocrReplace 规则
+    class OcrReplacer
+    {
+    public:
+        // replace 需要是已经做过等价类处理的
+        explicit OcrReplacer(const std::vector<std::pair<std::string, std::string>>& replace);
+
+        bool empty() const noexcept { return m_rules.empty(); }
+        void apply(std::string& text, bool replace_full) const;
+
+    private:
+        struct Rule
+        {
+            std::string pattern;
+            std::string new_str;
+            std::optional<std::regex> regex; // 为空表示 pattern 和 new_str 都是纯文本，直接按子串处理
+        };
+        std::vector<Rule> m_rules;
+    };
+
+    // 预编译好的 required 文字列表
+    class OcrRequiredMatcher
+    {
+    public:
+        // required 需要是已经做过等价类处理的
+        explicit OcrRequiredMatcher(std::vector<std::string> required);
+
+        bool empty() const noexcept { return m_texts.empty(); }
+        const std::vector<std::string>& texts() const noexcept { return m_texts; }
+
+        // 全字匹配
+        bool contains(const std::string& text) const { return m_text_set.contains(text); }
+        // 返回 required 中第一个（按列表顺序）是 text 子串的项
+        const std::string* first_substring_of(std::string_view text) const;
+
+    private:
+        std::vector<std::string> m_texts;
+        std::unordered_set<std::string> m_text_set;
+        utils::AhoCorasick m_automaton;
+    };
+
     class OcrConfig final : public SingletonHolder<OcrConfig>, public AbstractConfig
     {
     public:
@@ -20,11 +67,22 @@ namespace asst
 
         std::string process_equivalence_class(const std::string& str) const;
 
+        // 以下两个接口对传入的原始规则做等价类处理并编译，同样的规则只会编译一次
+        std::shared_ptr<const OcrReplacer> get_replacer(const std::vector<std::pair<std::string, std::string>>& replace);
+        std::shared_ptr<const OcrRequiredMatcher> get_required_matcher(const std::vector<std::string>& required);
+
     protected:
         virtual bool parse(const json::value& json) override;
 
         using equivalence_class = std::vector<std::string>;
 
+        // 规则集合的种类是有限的（基本来自 tasks.json），超过这个数量说明有动态生成的规则，直接清空重来
+        static constexpr size_t CompiledCacheCapacity = 4096;
+
         std::vector<equivalence_class> m_eq_classes;
+
+        std::mutex m_compiled_mutex;
+        std::unordered_map<std::string, std::shared_ptr<const OcrReplacer>> m_replacers;
+        std::unordered_map<std::string, std::shared_ptr<const OcrRequiredMatcher>> m_required_matchers;
     };
 } // namespace asst
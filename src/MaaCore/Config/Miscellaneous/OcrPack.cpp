@@ -1,6 +1,8 @@
 #include "OcrPack.h"
 
+#include <cstring>
 #include <filesystem>
+#include <numeric>
 
 #include "Utils/NoWarningCV.h"
 ASST_SUPPRESS_CV_WARNINGS_START
@@ -56,12 +58,24 @@ bool asst::OcrPack::load(const std::filesystem::path& path)
     if (m_det && m_rec) {
         m_ocr = std::make_unique<fastdeploy::pipeline::PPOCRv3>(m_det.get(), m_rec.get());
     }
+    else {
+        // 模型换了，之前的结果不能再用
+        cache_clear();
+    }
 
     return !m_det_model_path.empty() && !m_rec_model_path.empty() && !m_rec_label_path.empty();
 }
 
-asst::OcrPack::ResultsVec asst::OcrPack::recognize(const cv::Mat& image, bool without_det)
+asst::OcrPack::ResultsVec asst::OcrPack::recognize(const cv::Mat& image, bool without_det, bool use_cache)
 {
+    CacheKey key;
+    if (use_cache) {
+        key = cache_key(image, without_det);
+        if (auto cached = cache_get(key)) {
+            return std::move(cached).value();
+        }
+    }
+
     if (!check_and_load()) {
         Log.error(__FUNCTION__, "check_and_load failed");
         return {};
@@ -118,9 +132,170 @@ asst::OcrPack::ResultsVec asst::OcrPack::recognize(const cv::Mat& image, bool wi
         std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start_time).count();
     std::string class_type = utils::demangle(typeid(*this).name());
     Log.trace(class_type, raw_results, without_det ? "by OCR Rec" : "by OCR Pipeline", ", cost", costs, "ms");
+
+    if (use_cache) {
+        cache_put(key, raw_results);
+    }
     return raw_results;
 }
 
+asst::OcrPack::ResultsVec asst::OcrPack::recognize_batch(const std::vector<cv::Mat>& images, bool use_cache)
+{
+    if (images.empty()) {
+        return {};
+    }
+
+    std::vector<CacheKey> keys;
+    ResultsVec cached_results;
+    std::vector<int> indices;
+    if (use_cache) {
+        keys.reserve(images.size());
+        cached_results.resize(images.size());
+        for (size_t i = 0; i != images.size(); ++i) {
+            keys.emplace_back(cache_key(images[i], true));
+            if (auto cached = cache_get(keys.back()); cached && cached->size() == 1) {
+                cached_results[i] = std::move(cached->front());
+            }
+            else {
+                indices.emplace_back(static_cast<int>(i));
+            }
+        }
+        if (indices.empty()) {
+            return cached_results;
+        }
+    }
+    else {
+        indices.resize(images.size());
+        std::iota(indices.begin(), indices.end(), 0);
+    }
+
+    if (!check_and_load()) {
+        Log.error(__FUNCTION__, "check_and_load failed");
+        return {};
+    }
+
+    auto start_time = std::chrono::steady_clock::now();
+
+    // 同一个 batch 会被 pad 到其中最宽的那张，所以先按宽高比排序，让相近的图片凑在一起
+    auto ratio = [&](int i) { return static_cast<double>(images[i].cols) / std::max(images[i].rows, 1); };
+    ranges::stable_sort(indices, [&](int lhs, int rhs) { return ratio(lhs) < ratio(rhs); });
+
+    // BatchPredict 会按 indices 把结果写回原始下标
+    std::vector<std::string> texts(images.size());
+    std::vector<float> scores(images.size(), 0);
+    for (size_t start = 0; start < indices.size(); start += RecBatchSize) {
+        size_t end = std::min(start + RecBatchSize, indices.size());
+        if (!m_rec->BatchPredict(images, &texts, &scores, start, end, indices)) {
+            Log.error(__FUNCTION__, "BatchPredict failed", start, end);
+        }
+    }
+
+    ResultsVec raw_results = use_cache ? std::move(cached_results) : ResultsVec(images.size());
+    for (int i : indices) {
+        Result result {
+            .rect = Rect(0, 0, images[i].cols, images[i].rows),
+            .score = scores[i],
+            .text = std::move(texts[i]),
+        };
+        if (use_cache) {
+            cache_put(keys[i], { result });
+        }
+        raw_results[i] = std::move(result);
+    }
+
+    auto costs =
+        std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start_time).count();
+    std::string class_type = utils::demangle(typeid(*this).name());
+    Log.trace(class_type, raw_results, "by OCR Rec batch, size", indices.size(), "/", images.size(), ", cost", costs,
+              "ms");
+    return raw_results;
+}
+
+asst::OcrPack::CacheKey asst::OcrPack::cache_key(const cv::Mat& image, bool without_det)
+{
+    // 逐行按 8 字节做 FNV-1a 风格的混合，roi 不一定连续，不能直接当一整块内存算
+    // 同一遍里用两个不同的初始值和乘数各算一个 hash，一个查表，一个命中后校验
+    constexpr uint64_t Prime = 0x100000001b3ULL;
+    constexpr uint64_t CheckPrime = 0x9e3779b97f4a7c15ULL;
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    uint64_t check = 0x84222325cbf29ce4ULL;
+    auto mix = [&](uint64_t value) {
+        hash ^= value;
+        hash *= Prime;
+        hash ^= hash >> 29;
+        check ^= value + (check << 6) + (check >> 2);
+        check *= CheckPrime;
+        check ^= check >> 31;
+    };
+    mix(static_cast<uint64_t>(image.cols) << 32 | static_cast<uint32_t>(image.rows));
+    mix(static_cast<uint64_t>(image.type()) << 1 | (without_det ? 1 : 0));
+
+    const size_t row_bytes = image.cols * image.elemSize();
+    for (int r = 0; r < image.rows; ++r) {
+        const uchar* row = image.ptr<uchar>(r);
+        size_t i = 0;
+        for (; i + sizeof(uint64_t) <= row_bytes; i += sizeof(uint64_t)) {
+            uint64_t value = 0;
+            std::memcpy(&value, row + i, sizeof(value));
+            mix(value);
+        }
+        uint64_t tail = 0;
+        std::memcpy(&tail, row + i, row_bytes - i);
+        mix(tail);
+    }
+    return CacheKey {
+        .hash = hash,
+        .check = check,
+        .cols = image.cols,
+        .rows = image.rows,
+        .type = image.type(),
+        .without_det = without_det,
+    };
+}
+
+std::optional<asst::OcrPack::ResultsVec> asst::OcrPack::cache_get(const CacheKey& key)
+{
+    std::unique_lock<std::mutex> lock(m_cache_mutex);
+    auto iter = m_cache_index.find(key.hash);
+    // 查表用的 hash 撞上了但不是同一张图，当作没命中，之后 cache_put 会把旧的顶掉
+    if (iter == m_cache_index.end() || iter->second->first != key) {
+        ++m_cache_misses;
+        return std::nullopt;
+    }
+    ++m_cache_hits;
+    m_cache_list.splice(m_cache_list.begin(), m_cache_list, iter->second);
+
+    if ((m_cache_hits + m_cache_misses) % CacheCapacity == 0) {
+        Log.info(utils::demangle(typeid(*this).name()), "ocr cache hits", m_cache_hits, "misses", m_cache_misses,
+                 "size", m_cache_list.size());
+    }
+    return iter->second->second;
+}
+
+void asst::OcrPack::cache_put(const CacheKey& key, const ResultsVec& results)
+{
+    std::unique_lock<std::mutex> lock(m_cache_mutex);
+    if (auto iter = m_cache_index.find(key.hash); iter != m_cache_index.end()) {
+        iter->second->first = key;
+        iter->second->second = results;
+        m_cache_list.splice(m_cache_list.begin(), m_cache_list, iter->second);
+        return;
+    }
+    m_cache_list.emplace_front(key, results);
+    m_cache_index.emplace(key.hash, m_cache_list.begin());
+    while (m_cache_list.size() > CacheCapacity) {
+        m_cache_index.erase(m_cache_list.back().first.hash);
+        m_cache_list.pop_back();
+    }
+}
+
+void asst::OcrPack::cache_clear()
+{
+    std::unique_lock<std::mutex> lock(m_cache_mutex);
+    m_cache_list.clear();
+    m_cache_index.clear();
+}
+
 bool asst::OcrPack::check_and_load()
 {
     if (m_det && m_rec) {
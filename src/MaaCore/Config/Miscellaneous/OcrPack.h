@@ -3,6 +3,11 @@
 #include "Common/AsstTypes.h"
 #include "Config/AbstractResource.h"
 
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
 #include <vector>
 
 namespace cv
@@ -39,13 +44,38 @@ namespace asst
 
         virtual bool load(const std::filesystem::path& path) override;
 
-        ResultsVec recognize(const cv::Mat& image, bool without_det = false);
+        // use_cache: 以图像尺寸、类型和内容的两个 hash 为 key 缓存结果，命中时跳过推理
+        ResultsVec recognize(const cv::Mat& image, bool without_det = false, bool use_cache = false);
+        // 仅识别（不检测），按宽高比分桶后成批推理，返回值与输入一一对应、顺序一致
+        ResultsVec recognize_batch(const std::vector<cv::Mat>& images, bool use_cache = false);
 
     protected:
         OcrPack();
 
         bool check_and_load();
 
+        static constexpr size_t RecBatchSize = 8;
+        static constexpr size_t CacheCapacity = 1024;
+
+        // hash 只用来查表，命中后还要整个 key 都相同才算数：
+        // check 是另一个种子算出来的 hash，两个 64 位 hash 同时碰撞的概率可以忽略
+        struct CacheKey
+        {
+            uint64_t hash = 0;
+            uint64_t check = 0;
+            int cols = 0;
+            int rows = 0;
+            int type = 0;
+            bool without_det = false;
+
+            bool operator==(const CacheKey&) const = default;
+        };
+
+        static CacheKey cache_key(const cv::Mat& image, bool without_det);
+        std::optional<ResultsVec> cache_get(const CacheKey& key);
+        void cache_put(const CacheKey& key, const ResultsVec& results);
+        void cache_clear();
+
         std::unique_ptr<fastdeploy::vision::ocr::DBDetector> m_det;
         std::unique_ptr<fastdeploy::vision::ocr::Recognizer> m_rec;
         std::unique_ptr<fastdeploy::pipeline::PPOCRv3> m_ocr;
@@ -53,6 +83,14 @@ namespace asst
         std::filesystem::path m_det_model_path;
         std::filesystem::path m_rec_model_path;
         std::filesystem::path m_rec_label_path;
+
+        // LRU，最近使用的在 list 头部
+        using CacheList = std::list<std::pair<CacheKey, ResultsVec>>;
+        std::mutex m_cache_mutex;
+        CacheList m_cache_list;
+        std::unordered_map<uint64_t, CacheList::iterator> m_cache_index;
+        size_t m_cache_hits = 0;
+        size_t m_cache_misses = 0;
     };
 
     class WordOcr final : public SingletonHolder<WordOcr>, public OcrPack
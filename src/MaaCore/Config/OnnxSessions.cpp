@@ -1,7 +1,11 @@
 #include "OnnxSessions.h"
 
+#include <algorithm>
 #include <array>
 #include <filesystem>
+#include <functional>
+#include <limits>
+#include <numeric>
 #include <string_view>
 
 #include "Utils/Logger.hpp"
@@ -13,7 +17,10 @@ bool asst::OnnxSessions::load(const std::filesystem::path& path)
 
     std::string name = utils::path_to_utf8_string(path.stem());
 
+    std::unique_lock<std::mutex> lock(m_mutex);
     if (auto iter = m_model_paths.find(name); iter == m_model_paths.end() || iter->second != path) {
+        // 借出去的上下文自己持有 session，不受影响，归还时发现 session 已经换了就直接丢弃
+        m_idle_contexts.erase(name);
         m_sessions.erase(name);
         m_model_paths.insert_or_assign(name, path);
     }
@@ -21,12 +28,107 @@ bool asst::OnnxSessions::load(const std::filesystem::path& path)
     return true;
 }
 
-Ort::Session& asst::OnnxSessions::get(const std::string& name)
+std::shared_ptr<asst::OnnxContext> asst::OnnxSessions::get_context(const std::string& name)
 {
-    if (m_sessions.find(name) == m_sessions.end()) {
+    std::unique_ptr<OnnxContext> context;
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        if (auto& idle = m_idle_contexts[name]; !idle.empty()) {
+            context = std::move(idle.back());
+            idle.pop_back();
+        }
+        else {
+            context = std::make_unique<OnnxContext>(get_session_without_lock(name));
+        }
+    }
+    return std::shared_ptr<OnnxContext>(context.release(),
+                                        [this, name](OnnxContext* released) { release_context(name, released); });
+}
+
+std::shared_ptr<Ort::Session> asst::OnnxSessions::get_session_without_lock(const std::string& name)
+{
+    auto& session = m_sessions[name];
+    if (!session) {
         Log.info(__FUNCTION__, "lazy load", name);
-        Ort::Session session(m_env, m_model_paths.at(name).c_str(), m_options);
-        m_sessions.emplace(name, std::move(session));
+        session = std::make_shared<Ort::Session>(m_env, m_model_paths.at(name).c_str(), m_options);
+    }
+    return session;
+}
+
+void asst::OnnxSessions::release_context(const std::string& name, OnnxContext* context)
+{
+    std::unique_ptr<OnnxContext> holder(context);
+    std::unique_lock<std::mutex> lock(m_mutex);
+    auto session_iter = m_sessions.find(name);
+    if (session_iter == m_sessions.end() || session_iter->second != holder->m_session) {
+        return;
     }
-    return m_sessions.at(name);
+    if (auto& idle = m_idle_contexts[name]; idle.size() < MaxIdleContexts) {
+        idle.emplace_back(std::move(holder));
+    }
+}
+
+asst::OnnxContext::OnnxContext(std::shared_ptr<Ort::Session> session)
+    : m_session(std::move(session)), m_memory_info(Ort::MemoryInfo::CreateCpu(OrtDeviceAllocator, OrtMemTypeCPU))
+{
+    Ort::AllocatorWithDefaultOptions allocator;
+    m_input_name = m_session->GetInputNameAllocated(0, allocator).get();
+    m_output_name = m_session->GetOutputNameAllocated(0, allocator).get();
+    m_input_shape = m_session->GetInputTypeInfo(0).GetTensorTypeAndShapeInfo().GetShape();
+    m_output_shape = m_session->GetOutputTypeInfo(0).GetTensorTypeAndShapeInfo().GetShape();
+
+    // 除了 batch 以外的维度都要是固定的，才能提前分配好内存
+    auto sample_size = [](const std::vector<int64_t>& shape) -> size_t {
+        if (shape.empty() || std::any_of(shape.begin() + 1, shape.end(), [](int64_t d) { return d <= 0; })) {
+            return 0;
+        }
+        return std::accumulate(shape.begin() + 1, shape.end(), size_t(1), std::multiplies<size_t>());
+    };
+    m_input_sample_size = sample_size(m_input_shape);
+    m_output_sample_size = sample_size(m_output_shape);
+    if (m_input_sample_size == 0 || m_output_sample_size == 0) {
+        Log.error(__FUNCTION__, "unsupported model shape, input:", m_input_shape, "output:", m_output_shape);
+    }
+}
+
+int64_t asst::OnnxContext::max_batch() const noexcept
+{
+    if (m_input_shape.empty() || m_input_shape.front() <= 0) {
+        return std::numeric_limits<int64_t>::max();
+    }
+    return m_input_shape.front();
+}
+
+float* asst::OnnxContext::input_buffer(int64_t batch)
+{
+    if (batch != m_batch) {
+        bind(batch);
+    }
+    return m_input.data();
+}
+
+const float* asst::OnnxContext::run()
+{
+    const char* input_names[] = { m_input_name.c_str() };
+    const char* output_names[] = { m_output_name.c_str() };
+    m_session->Run(m_run_options, input_names, &m_input_tensor, 1, output_names, &m_output_tensor, 1);
+    return m_output.data();
+}
+
+void asst::OnnxContext::bind(int64_t batch)
+{
+    m_batch = batch;
+
+    m_batch_input_shape = m_input_shape;
+    m_batch_input_shape.front() = batch;
+    m_batch_output_shape = m_output_shape;
+    m_batch_output_shape.front() = batch;
+
+    m_input.resize(batch * m_input_sample_size);
+    m_output.resize(batch * m_output_sample_size);
+
+    m_input_tensor = Ort::Value::CreateTensor<float>(m_memory_info, m_input.data(), m_input.size(),
+                                                     m_batch_input_shape.data(), m_batch_input_shape.size());
+    m_output_tensor = Ort::Value::CreateTensor<float>(m_memory_info, m_output.data(), m_output.size(),
+                                                      m_batch_output_shape.data(), m_batch_output_shape.size());
 }
@@ -2,24 +2,86 @@
 
 #include "AbstractResource.h"
 
+#include <memory>
+#include <mutex>
 #include <unordered_map>
+#include <vector>
 
 #include <onnxruntime/core/session/onnxruntime_cxx_api.h>
 
 namespace asst
 {
+    // 推理上下文：缓存输入输出的名字和形状，并复用输入输出的内存，batch 不变时反复推理不会再分配内存
+    // 一份上下文同一时间只能由一个调用方使用，通过 OnnxSessions::get_context 借用，用完自动归还
+    class OnnxContext
+    {
+    public:
+        explicit OnnxContext(std::shared_ptr<Ort::Session> session);
+        OnnxContext(const OnnxContext&) = delete;
+        OnnxContext(OnnxContext&&) = delete;
+        ~OnnxContext() = default;
+
+        // 模型的输入输出形状，batch 维度不固定时为 -1
+        const std::vector<int64_t>& input_shape() const noexcept { return m_input_shape; }
+        const std::vector<int64_t>& output_shape() const noexcept { return m_output_shape; }
+        // 一次推理最多能放多少个样本
+        int64_t max_batch() const noexcept;
+        size_t input_sample_size() const noexcept { return m_input_sample_size; }
+        size_t output_sample_size() const noexcept { return m_output_sample_size; }
+
+        // 准备 batch 个样本的输入缓冲区，调用方直接往里面填数据
+        float* input_buffer(int64_t batch = 1);
+        // 用 input_buffer 中的数据推理，返回的输出在下次推理前有效
+        const float* run();
+
+        OnnxContext& operator=(const OnnxContext&) = delete;
+        OnnxContext& operator=(OnnxContext&&) = delete;
+
+    private:
+        friend class OnnxSessions;
+
+        void bind(int64_t batch);
+
+        std::shared_ptr<Ort::Session> m_session; // 模型重新加载后，借出去的上下文仍然持有旧的 session
+        std::string m_input_name;
+        std::string m_output_name;
+        std::vector<int64_t> m_input_shape;
+        std::vector<int64_t> m_output_shape;
+        size_t m_input_sample_size = 0;
+        size_t m_output_sample_size = 0;
+
+        int64_t m_batch = 0;
+        std::vector<int64_t> m_batch_input_shape;
+        std::vector<int64_t> m_batch_output_shape;
+        std::vector<float> m_input;
+        std::vector<float> m_output;
+        Ort::MemoryInfo m_memory_info;
+        Ort::Value m_input_tensor { nullptr };
+        Ort::Value m_output_tensor { nullptr };
+        Ort::RunOptions m_run_options;
+    };
+
     class OnnxSessions final : public SingletonHolder<OnnxSessions>, public AbstractResource
     {
     public:
         virtual ~OnnxSessions() override = default;
         virtual bool load(const std::filesystem::path& path) override;
 
-        Ort::Session& get(const std::string& name);
+        // 借一份推理上下文，返回的指针析构时归还，留给之后的调用复用
+        // 每个调用方各用各的，多个实例、多个线程可以同时推理同一个模型（Ort::Session::Run 本身是线程安全的）
+        std::shared_ptr<OnnxContext> get_context(const std::string& name);
 
     private:
+        static constexpr size_t MaxIdleContexts = 4; // 每个模型最多留着这么多份空闲的上下文
+
+        std::shared_ptr<Ort::Session> get_session_without_lock(const std::string& name);
+        void release_context(const std::string& name, OnnxContext* context);
+
         Ort::Env m_env;
         Ort::SessionOptions m_options;
-        std::unordered_map<std::string, Ort::Session> m_sessions;
+        std::mutex m_mutex;
+        std::unordered_map<std::string, std::shared_ptr<Ort::Session>> m_sessions;
+        std::unordered_map<std::string, std::vector<std::unique_ptr<OnnxContext>>> m_idle_contexts;
         std::unordered_map<std::string, std::filesystem::path> m_model_paths;
     };
 }
@@ -9,10 +9,12 @@
 
 #include "Common/AsstTypes.h"
 #include "GeneralConfig.h"
+#include "Miscellaneous/OcrConfig.h"
 #include "TemplResource.h"
 #include "Utils/Logger.hpp"
 #include "Utils/Ranges.hpp"
 #include "Utils/StringMisc.hpp"
+#include "Vision/Hasher.h"
 
 namespace asst
 {
@@ -146,6 +148,19 @@ std::shared_ptr<asst::TaskInfo> asst::TaskData::get_raw(std::string_view name)
 }
 
 std::shared_ptr<asst::TaskInfo> asst::TaskData::get(std::string_view name)
+{
+    {
+        // 绝大多数时候任务已经生成过了，只读不写，多个线程可以同时查
+        std::shared_lock<std::shared_mutex> lock(m_mutex);
+        if (auto it = m_all_tasks_info.find(name); it != m_all_tasks_info.cend()) [[likely]] {
+            return it->second;
+        }
+    }
+    std::unique_lock<std::shared_mutex> lock(m_mutex);
+    return get_without_lock(name);
+}
+
+std::shared_ptr<asst::TaskInfo> asst::TaskData::get_without_lock(std::string_view name)
 {
     // 普通 task 或已经生成过的 `@` 型 task
     if (auto it = m_all_tasks_info.find(name); it != m_all_tasks_info.cend()) [[likely]] {
@@ -155,6 +170,43 @@ std::shared_ptr<asst::TaskInfo> asst::TaskData::get(std::string_view name)
     return expand_task(name, get_raw(name)).value_or(nullptr);
 }
 
+std::vector<std::string> asst::TaskData::get_reachable_templs(const std::vector<std::string>& entries)
+{
+    // 一路上会生成不少还没用到过的任务，整个过程都占着锁
+    std::unique_lock<std::shared_mutex> lock(m_mutex);
+    std::vector<std::string> templs;
+    std::unordered_set<std::string> visited_templs;
+    std::unordered_set<std::string> visited_tasks(entries.cbegin(), entries.cend());
+    std::queue<std::string> bfs;
+    for (const std::string& entry : entries) {
+        bfs.emplace(entry);
+    }
+
+    while (!bfs.empty()) {
+        auto task_ptr = get_without_lock(bfs.front());
+        bfs.pop();
+        if (!task_ptr) {
+            continue;
+        }
+        if (auto match_task_ptr = std::dynamic_pointer_cast<MatchTaskInfo>(task_ptr)) {
+            for (const std::string& templ : match_task_ptr->templ_names) {
+                if (visited_templs.emplace(templ).second) {
+                    templs.emplace_back(templ);
+                }
+            }
+        }
+        for (const auto* tasks : { &task_ptr->sub, &task_ptr->next, &task_ptr->exceeded_next,
+                                   &task_ptr->on_error_next }) {
+            for (const std::string& name : *tasks) {
+                if (visited_tasks.emplace(name).second) {
+                    bfs.emplace(name);
+                }
+            }
+        }
+    }
+    return templs;
+}
+
 bool asst::TaskData::lazy_parse(const json::value& json)
 {
     LogTraceFunction;
@@ -164,6 +216,7 @@ bool asst::TaskData::lazy_parse(const json::value& json)
         return false;
     }
 
+    std::unique_lock<std::shared_mutex> lock(m_mutex);
     for (const auto& [name, task_json] : json.as_object()) {
         std::string_view name_view = task_name_view(name);
         if (task_json.get("baseTask", "") == "#none") {
@@ -181,7 +234,7 @@ bool asst::TaskData::lazy_parse(const json::value& json)
         }
     }
 
-    clear_tasks();
+    clear_tasks_without_lock();
 
 #ifdef ASST_DEBUG
     {
@@ -203,7 +256,7 @@ bool asst::TaskData::lazy_parse(const json::value& json)
         while (!task_queue.empty() && checking_task_set.size() <= MAX_CHECKING_SIZE) {
             std::string_view name = task_queue.front();
             task_queue.pop();
-            auto task = get(name);
+            auto task = get_without_lock(name);
             if (task == nullptr) [[unlikely]] {
                 Log.error("Task", name, "not successfully generated");
                 validity = false;
@@ -261,7 +314,7 @@ bool asst::TaskData::lazy_parse(const json::value& json)
         else {
             Log.trace(checking_task_set.size(), "tasks checked.");
         }
-        clear_tasks();
+        clear_tasks_without_lock();
         if (!validity) return false;
     }
 #endif
@@ -276,6 +329,7 @@ bool asst::TaskData::parse(const json::value& json)
     if (!lazy_parse(json)) return false;
 
     // 本来重构之后完全支持惰性加载，但是发现模板图片不支持（
+    std::unique_lock<std::shared_mutex> lock(m_mutex);
     for (std::string_view name : m_json_all_tasks_info | views::keys) {
         generate_task_and_its_base(name, true);
     }
@@ -284,6 +338,12 @@ bool asst::TaskData::parse(const json::value& json)
 }
 
 void asst::TaskData::clear_tasks()
+{
+    std::unique_lock<std::shared_mutex> lock(m_mutex);
+    clear_tasks_without_lock();
+}
+
+void asst::TaskData::clear_tasks_without_lock()
 {
     // 注意：这会导致已经通过 get 获取的任务指针内容不会更新
     // 即运行期修改对已经获取的任务指针无效，但是不会导致崩溃；要想更新，需要重新获取任务指针
@@ -296,8 +356,9 @@ void asst::TaskData::clear_tasks()
 
 void asst::TaskData::set_task_base(const std::string_view task_name, std::string base_task_name)
 {
+    std::unique_lock<std::shared_mutex> lock(m_mutex);
     m_json_all_tasks_info[task_name_view(task_name)]["baseTask"] = std::move(base_task_name);
-    clear_tasks();
+    clear_tasks_without_lock();
 }
 
 // new_tasks 是目的任务列表
@@ -898,6 +959,10 @@ asst::TaskData::taskptr_t asst::TaskData::generate_match_task_info(std::string_v
     }
 
     get_and_check_value(task_json, "maskRange", match_task_info_ptr->mask_range, default_ptr->mask_range);
+    get_and_check_value(task_json, "pyramidLevels", match_task_info_ptr->pyramid_levels,
+                        default_ptr->pyramid_levels);
+    get_and_check_value(task_json, "pyramidTolerance", match_task_info_ptr->pyramid_tolerance,
+                        default_ptr->pyramid_tolerance);
     return match_task_info_ptr;
 }
 
@@ -921,8 +986,19 @@ asst::TaskData::taskptr_t asst::TaskData::generate_ocr_task_info([[maybe_unused]
     get_and_check_value(task_json, "fullMatch", ocr_task_info_ptr->full_match, default_ptr->full_match);
     get_and_check_value(task_json, "isAscii", ocr_task_info_ptr->is_ascii, default_ptr->is_ascii);
     get_and_check_value(task_json, "withoutDet", ocr_task_info_ptr->without_det, default_ptr->without_det);
+    get_and_check_value(task_json, "ocrCache", ocr_task_info_ptr->use_ocr_cache, default_ptr->use_ocr_cache);
+    get_and_check_value(task_json, "digitOcr", ocr_task_info_ptr->use_digit_ocr, default_ptr->use_digit_ocr);
     get_and_check_value(task_json, "replaceFull", ocr_task_info_ptr->replace_full, default_ptr->replace_full);
     get_and_check_value(task_json, "ocrReplace", ocr_task_info_ptr->replace_map, default_ptr->replace_map);
+
+    // 加载时就把 text 和 ocrReplace 编译好，识别时直接从 OcrConfig 的缓存里取
+    auto& ocr_config = OcrConfig::get_instance();
+    if (!ocr_task_info_ptr->text.empty()) {
+        ocr_config.get_required_matcher(ocr_task_info_ptr->text);
+    }
+    if (!ocr_task_info_ptr->replace_map.empty()) {
+        ocr_config.get_replacer(ocr_task_info_ptr->replace_map);
+    }
     return ocr_task_info_ptr;
 }
 
@@ -936,7 +1012,18 @@ asst::TaskData::taskptr_t asst::TaskData::generate_hash_task_info([[maybe_unused
     auto hash_task_info_ptr = std::make_shared<HashTaskInfo>();
     // hash 不允许为字符串，必须是字符串数组，不能用 get_and_check_value
     auto array_opt = task_json.find<json::array>("hash");
-    hash_task_info_ptr->hashes = array_opt ? to_string_list(array_opt.value()) : default_ptr->hashes;
+    if (array_opt) {
+        hash_task_info_ptr->hashes = to_string_list(array_opt.value());
+        auto hash_index = std::make_shared<HashIndex>();
+        for (const std::string& hash : hash_task_info_ptr->hashes) {
+            hash_index->insert(hash, Hasher::to_hash_bits(hash));
+        }
+        hash_task_info_ptr->hash_index = std::move(hash_index);
+    }
+    else {
+        hash_task_info_ptr->hashes = default_ptr->hashes;
+        hash_task_info_ptr->hash_index = default_ptr->hash_index;
+    }
 #ifdef ASST_DEBUG
     if (!array_opt && default_ptr->hashes.empty()) {
         Log.warn("Hash task", name, "has implicit empty hashes.");
@@ -1048,26 +1135,26 @@ bool asst::TaskData::syntax_check(std::string_view task_name, const json::value&
     static const std::unordered_map<AlgorithmType, std::unordered_set<std::string>> allowed_key_under_algorithm = {
         { AlgorithmType::Invalid,
           {
-              "action",        "algorithm", "baseTask",        "cache",          "exceededNext",     "fullMatch",
-              "hash",          "isAscii",   "maskRange",       "maxTimes",       "next",             "ocrReplace",
-              "onErrorNext",   "postDelay", "preDelay",        "rectMove",       "reduceOtherTimes", "replaceFull", "roi",
-              "specialParams", "sub",       "subErrorIgnored", "templThreshold", "template",         "text",
-              "threshold",     "withoutDet",
+              "action",           "algorithm",       "baseTask",         "cache",       "digitOcr", "exceededNext",
+              "fullMatch",        "hash",            "isAscii",          "maskRange",   "maxTimes", "next",
+              "ocrCache",         "ocrReplace",      "onErrorNext",      "postDelay",   "preDelay", "pyramidLevels",
+              "pyramidTolerance", "rectMove",        "reduceOtherTimes", "replaceFull", "roi",      "specialParams",
+              "sub",              "subErrorIgnored", "templThreshold",   "template",    "text",     "threshold",
+              "withoutDet",
           } },
         { AlgorithmType::MatchTemplate,
           {
-              "action",           "algorithm", "baseTask",    "cache",           "exceededNext",   "maskRange",
-              "maxTimes",         "next",      "onErrorNext", "postDelay",       "preDelay",       "rectMove",
-              "reduceOtherTimes", "roi",       "sub",         "subErrorIgnored", "templThreshold", "template",
-              "specialParams"
+              "action",           "algorithm", "baseTask",         "cache",     "exceededNext", "maskRange",
+              "maxTimes",         "next",      "onErrorNext",      "postDelay", "preDelay",     "pyramidLevels",
+              "pyramidTolerance", "rectMove",  "reduceOtherTimes", "roi",       "sub",          "subErrorIgnored",
+              "templThreshold",   "template",  "specialParams"
           } },
         { AlgorithmType::OcrDetect,
           {
-              "action",      "algorithm", "baseTask",        "cache",    "exceededNext",
-              "fullMatch",   "isAscii",   "maxTimes",        "next",     "ocrReplace",
-              "onErrorNext", "postDelay", "preDelay",        "rectMove", "reduceOtherTimes", "replaceFull",
-              "roi",         "sub",       "subErrorIgnored", "text",     "withoutDet",
-              "specialParams"
+              "action",      "algorithm",     "baseTask", "cache",           "digitOcr",         "exceededNext",
+              "fullMatch",   "isAscii",       "maxTimes", "next",            "ocrCache",         "ocrReplace",
+              "onErrorNext", "postDelay",     "preDelay", "rectMove",        "reduceOtherTimes", "replaceFull",
+              "roi",         "specialParams", "sub",      "subErrorIgnored", "text",             "withoutDet"
           } },
         { AlgorithmType::JustReturn,
           {
@@ -1109,7 +1196,7 @@ bool asst::TaskData::syntax_check(std::string_view task_name, const json::value&
     }
 
     bool validity = true;
-    auto task_ptr = get(task_name);
+    auto task_ptr = get_without_lock(task_name);
     if (task_ptr == nullptr) {
         Log.error("TaskData::syntax_check | Task", task_name, "has not been generated.");
         return false;
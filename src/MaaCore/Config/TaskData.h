@@ -4,8 +4,10 @@
 
 #include <memory>
 #include <optional>
+#include <shared_mutex>
 #include <unordered_map>
 #include <unordered_set>
+#include <vector>
 
 #include "Common/AsstTypes.h"
 
@@ -146,6 +148,8 @@ namespace asst
         bool syntax_check(std::string_view task_name, const json::value& task_json);
 #endif
         std::shared_ptr<TaskInfo> get_raw(std::string_view name);
+        std::shared_ptr<TaskInfo> get_without_lock(std::string_view name);
+        void clear_tasks_without_lock();
         template <typename TargetTaskInfoType>
         requires(std::derived_from<TargetTaskInfoType, TaskInfo> &&
                  !std::same_as<TargetTaskInfoType, TaskInfo>) // Parameter must be a TaskInfo
@@ -169,8 +173,12 @@ namespace asst
         {
             return std::dynamic_pointer_cast<TargetTaskInfoType>(get(name));
         }
+        // 从 entries 出发，沿 sub、next、exceeded_next、on_error_next 能走到的所有任务用到的模板（去重）
+        // 按广度优先的顺序，离入口近的排在前面
+        std::vector<std::string> get_reachable_templs(const std::vector<std::string>& entries);
         std::optional<json::object> get_json(std::string_view name) const
         {
+            std::shared_lock<std::shared_mutex> lock(m_mutex);
             if (m_json_all_tasks_info.find(name) != m_json_all_tasks_info.cend())
                 return m_json_all_tasks_info.at(name);
             else
@@ -188,6 +196,8 @@ namespace asst
 
         virtual bool parse(const json::value& json) override;
 
+        // 任务是用到时才生成的，get 也会改动下面这些表；多开时各实例、以及识别的工作线程都会同时调用
+        mutable std::shared_mutex m_mutex;
         std::unordered_set<std::string> m_task_names;
         std::unordered_map<std::string_view, taskptr_t> m_raw_all_tasks_info;
         std::unordered_map<std::string_view, taskptr_t> m_all_tasks_info;
@@ -4,6 +4,7 @@
 #include <filesystem>
 #include <string_view>
 
+#include "GeneralConfig.h"
 #include "Utils/ImageIo.hpp"
 #include "Utils/Logger.hpp"
 #include "Utils/NoWarningCV.h"
@@ -18,6 +19,7 @@ bool asst::TemplResource::load(const std::filesystem::path& path)
     LogTraceFunction;
     Log.info("load", path);
 
+    std::unique_lock<std::shared_mutex> lock(m_paths_mutex);
 #ifdef ASST_DEBUG
     bool some_file_not_exists = false;
 #endif
@@ -30,7 +32,11 @@ bool asst::TemplResource::load(const std::filesystem::path& path)
         if (std::filesystem::exists(filepath)) {
             if (auto path_iter = m_templ_paths.find(name);
                 path_iter == m_templ_paths.end() || path_iter->second != filepath) {
-                m_templs.erase(name);
+                Shard& shard = shard_of(name);
+                std::unique_lock<std::mutex> shard_lock(shard.mutex);
+                if (auto iter = shard.entries.find(name); iter != shard.entries.end()) {
+                    erase_without_lock(shard, iter);
+                }
                 m_templ_paths.insert_or_assign(name, filepath);
             }
         }
@@ -54,25 +60,205 @@ bool asst::TemplResource::load(const std::filesystem::path& path)
     return true;
 }
 
-const cv::Mat& asst::TemplResource::get_templ(const std::string& name)
+cv::Mat asst::TemplResource::get_templ(const std::string& name)
 {
-    if (m_templs.find(name) == m_templs.cend()) {
-        Log.info(__FUNCTION__, "lazy load", name);
-
-        auto path_iter = m_templ_paths.find(name);
-        if (path_iter == m_templ_paths.cend()) {
-            Log.error(__FUNCTION__, "templ not found", name);
+    Shard& shard = shard_of(name);
+    {
+        std::unique_lock<std::mutex> lock(shard.mutex);
+        if (Entry* entry = touch_without_lock(shard, name)) {
+            ++m_hits;
+            ++entry->hits;
+            const size_t budget = shard_budget();
+            if (budget != 0 && !entry->pinned && entry->hits >= HotHits &&
+                shard.pinned_bytes + entry->bytes <= budget / 2) {
+                entry->pinned = true;
+                shard.pinned_bytes += entry->bytes;
+            }
+            return entry->templ;
+        }
+    }
+    ++m_misses;
 
+    auto path_opt = templ_path(name);
+    if (!path_opt) {
+        Log.error(__FUNCTION__, "templ not found", name);
 #ifdef ASST_DEBUG
-            throw std::runtime_error("templ not found: " + name);
+        throw std::runtime_error("templ not found: " + name);
 #else
-            static cv::Mat empty;
-            return empty;
+        return {};
 #endif
+    }
+    Log.info(__FUNCTION__, "lazy load", name);
+    return load_templ(shard, name, *path_opt);
+}
+
+bool asst::TemplResource::preload(const std::string& name, size_t memory_limit)
+{
+    // 缓存快满了就不再预加载，免得把正在用的模板挤出去
+    const size_t budget = shard_budget() * ShardCount;
+    if (m_bytes >= memory_limit || (budget != 0 && m_bytes >= budget / 4 * 3)) {
+        return false;
+    }
+
+    Shard& shard = shard_of(name);
+    {
+        std::unique_lock<std::mutex> lock(shard.mutex);
+        if (shard.entries.contains(name)) {
+            return true;
         }
+    }
+    if (auto path_opt = templ_path(name)) {
+        load_templ(shard, name, *path_opt);
+    }
+    return true;
+}
 
-        cv::Mat templ = asst::imread(path_iter->second);
-        m_templs.emplace(name, std::move(templ));
+std::shared_ptr<const asst::TemplArtifacts> asst::TemplResource::get_artifacts(const std::string& name,
+                                                                             const std::string& key,
+                                                                             const ArtifactsMaker& maker)
+{
+    Shard& shard = shard_of(name);
+    {
+        std::unique_lock<std::mutex> lock(shard.mutex);
+        if (Entry* entry = touch_without_lock(shard, name)) {
+            if (auto iter = entry->artifacts.find(key); iter != entry->artifacts.cend()) {
+                return iter->second;
+            }
+        }
+    }
+
+    const cv::Mat templ = get_templ(name);
+    if (templ.empty()) {
+        return nullptr;
+    }
+    // 生成可能比较慢（缩放、二值化），不占着锁
+    auto artifacts = std::make_shared<const TemplArtifacts>(maker(templ));
+
+    std::unique_lock<std::mutex> lock(shard.mutex);
+    auto entry_iter = shard.entries.find(name);
+    // 这期间模板可能已经被淘汰或重新加载了，那就只给这一次用
+    if (entry_iter == shard.entries.end() || entry_iter->second.templ.data != templ.data) {
+        return artifacts;
+    }
+    Entry& entry = entry_iter->second;
+    auto [iter, inserted] = entry.artifacts.emplace(key, std::move(artifacts));
+    if (inserted) {
+        const TemplArtifacts& added = *iter->second;
+        add_bytes_without_lock(shard, entry,
+                               bytes_of(added.mask) + bytes_of(added.coarse_templ) + bytes_of(added.coarse_mask));
+    }
+    auto result = iter->second;
+    evict_without_lock(shard, name);
+    return result;
+}
+
+asst::TemplResource::Stats asst::TemplResource::get_stats() const noexcept
+{
+    return Stats { .hits = m_hits, .misses = m_misses, .evictions = m_evictions, .bytes = m_bytes };
+}
+
+asst::TemplResource::Shard& asst::TemplResource::shard_of(const std::string& name)
+{
+    return m_shards[std::hash<std::string> {}(name) % ShardCount];
+}
+
+std::optional<std::filesystem::path> asst::TemplResource::templ_path(const std::string& name) const
+{
+    std::shared_lock<std::shared_mutex> lock(m_paths_mutex);
+    auto path_iter = m_templ_paths.find(name);
+    if (path_iter == m_templ_paths.cend()) {
+        return std::nullopt;
     }
-    return m_templs.at(name);
+    return path_iter->second;
+}
+
+cv::Mat asst::TemplResource::load_templ(Shard& shard, const std::string& name, const std::filesystem::path& path)
+{
+    // 读文件、解码比较慢，不占着锁，其他线程这时还能正常取模板
+    cv::Mat templ = asst::imread(path);
+    if (templ.empty()) {
+        return templ;
+    }
+
+    std::shared_lock<std::shared_mutex> paths_lock(m_paths_mutex);
+    if (auto path_iter = m_templ_paths.find(name); path_iter == m_templ_paths.cend() || path_iter->second != path) {
+        return templ;
+    }
+    std::unique_lock<std::mutex> lock(shard.mutex);
+    // 其他线程可能同时也在读，先放进去的为准
+    if (Entry* entry = touch_without_lock(shard, name)) {
+        return entry->templ;
+    }
+
+    Entry& entry = shard.entries[name];
+    entry.templ = templ;
+    shard.lru.emplace_front(name);
+    entry.lru_iter = shard.lru.begin();
+    add_bytes_without_lock(shard, entry, bytes_of(templ));
+    evict_without_lock(shard, name);
+    return templ;
+}
+
+asst::TemplResource::Entry* asst::TemplResource::touch_without_lock(Shard& shard, const std::string& name)
+{
+    auto iter = shard.entries.find(name);
+    if (iter == shard.entries.end()) {
+        return nullptr;
+    }
+    Entry& entry = iter->second;
+    shard.lru.splice(shard.lru.begin(), shard.lru, entry.lru_iter);
+    return &entry;
+}
+
+void asst::TemplResource::add_bytes_without_lock(Shard& shard, Entry& entry, size_t bytes)
+{
+    entry.bytes += bytes;
+    shard.bytes += bytes;
+    if (entry.pinned) {
+        shard.pinned_bytes += bytes;
+    }
+    m_bytes += bytes;
+}
+
+std::list<std::string>::iterator asst::TemplResource::erase_without_lock(
+    Shard& shard, std::unordered_map<std::string, Entry>::iterator iter)
+{
+    const Entry& entry = iter->second;
+    shard.bytes -= entry.bytes;
+    if (entry.pinned) {
+        shard.pinned_bytes -= entry.bytes;
+    }
+    m_bytes -= entry.bytes;
+    auto lru_iter = entry.lru_iter;
+    shard.entries.erase(iter);
+    return shard.lru.erase(lru_iter);
+}
+
+void asst::TemplResource::evict_without_lock(Shard& shard, const std::string& keep)
+{
+    const size_t budget = shard_budget();
+    if (budget == 0) {
+        return;
+    }
+    // 从最久没用过的开始淘汰，跳过钉住的和刚用到的
+    auto lru_iter = shard.lru.end();
+    while (shard.bytes > budget && lru_iter != shard.lru.begin()) {
+        --lru_iter;
+        if (*lru_iter == keep) {
+            continue;
+        }
+        auto entry_iter = shard.entries.find(*lru_iter);
+        if (entry_iter->second.pinned) {
+            continue;
+        }
+        ++m_evictions;
+        Log.trace("TemplResource evict", *lru_iter, "bytes", entry_iter->second.bytes);
+        lru_iter = erase_without_lock(shard, entry_iter);
+    }
+}
+
+size_t asst::TemplResource::shard_budget() noexcept
+{
+    const int limit_mb = Config.get_options().templ_cache_memory_limit;
+    return limit_mb > 0 ? static_cast<size_t>(limit_mb) * 1024 * 1024 / ShardCount : 0;
 }
@@ -2,6 +2,14 @@
 
 #include "AbstractResource.h"
 
+#include <array>
+#include <atomic>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
 #include <unordered_map>
 #include <unordered_set>
 
@@ -10,19 +18,92 @@
 
 namespace asst
 {
+    // 由模板派生出的数据，与截图无关，同一模板、同样的参数只需要计算一次
+    struct TemplArtifacts
+    {
+        cv::Mat mask;         // 由模板本身生成的掩码，不使用掩码时为空
+        cv::Mat coarse_templ; // 由粗到精匹配时缩小后的模板，不启用时为空
+        cv::Mat coarse_mask;
+        int coarse_scale = 1; // 缩小的倍数
+    };
+
     class TemplResource final : public SingletonHolder<TemplResource>, public AbstractResource
     {
     public:
+        struct Stats
+        {
+            size_t hits = 0;
+            size_t misses = 0;
+            size_t evictions = 0;
+            size_t bytes = 0; // 当前缓存的模板及其派生数据占用的内存
+        };
+
         virtual ~TemplResource() override = default;
 
         void set_load_required(std::unordered_set<std::string> required) noexcept;
         virtual bool load(const std::filesystem::path& path) override;
 
-        const cv::Mat& get_templ(const std::string& name);
+        // 返回的图像与缓存共享内存，请当作只读使用；之后被淘汰出缓存也不影响已经拿到的图像
+        cv::Mat get_templ(const std::string& name);
+        // 预先读取、解码模板，免得第一次识别时才去读文件。已加载的模板总共占用的内存达到 memory_limit 时不再读取，返回 false
+        bool preload(const std::string& name, size_t memory_limit);
+
+        using ArtifactsMaker = std::function<TemplArtifacts(const cv::Mat& templ)>;
+        // key 需要能区分生成时用到的参数；模板重新加载或被淘汰时会一并失效
+        std::shared_ptr<const TemplArtifacts> get_artifacts(const std::string& name, const std::string& key,
+                                                            const ArtifactsMaker& maker);
+
+        Stats get_stats() const noexcept;
 
     private:
+        // 按模板名分片，各片各自加锁、各自按 LRU 淘汰，多个实例同时识别时不会都挤在一把锁上
+        static constexpr size_t ShardCount = 16;
+        // 命中这么多次的模板算热门模板，钉在缓存里不淘汰；钉住的内存不超过每片预算的一半
+        static constexpr size_t HotHits = 50;
+
+        struct Entry
+        {
+            cv::Mat templ;
+            std::unordered_map<std::string, std::shared_ptr<const TemplArtifacts>> artifacts;
+            size_t bytes = 0;
+            size_t hits = 0;
+            bool pinned = false;
+            std::list<std::string>::iterator lru_iter;
+        };
+
+        struct Shard
+        {
+            std::mutex mutex;
+            std::unordered_map<std::string, Entry> entries;
+            std::list<std::string> lru; // 最近用过的在前面
+            size_t bytes = 0;
+            size_t pinned_bytes = 0;
+        };
+
+        Shard& shard_of(const std::string& name);
+        std::optional<std::filesystem::path> templ_path(const std::string& name) const;
+        // 读取并放进缓存，返回读到的图像。读取期间路径被 load 换掉了的话不放进缓存
+        cv::Mat load_templ(Shard& shard, const std::string& name, const std::filesystem::path& path);
+
+        // 以下需要持有 shard.mutex
+        Entry* touch_without_lock(Shard& shard, const std::string& name);
+        void add_bytes_without_lock(Shard& shard, Entry& entry, size_t bytes);
+        std::list<std::string>::iterator erase_without_lock(Shard& shard,
+                                                            std::unordered_map<std::string, Entry>::iterator iter);
+        void evict_without_lock(Shard& shard, const std::string& keep);
+
+        static size_t bytes_of(const cv::Mat& mat) noexcept { return mat.total() * mat.elemSize(); }
+        // 每片的内存预算，0 为不限制
+        static size_t shard_budget() noexcept;
+
         std::unordered_set<std::string> m_load_required;
-        std::unordered_map<std::string, cv::Mat> m_templs;
+        mutable std::shared_mutex m_paths_mutex;
         std::unordered_map<std::string, std::filesystem::path> m_templ_paths;
+        std::array<Shard, ShardCount> m_shards;
+
+        std::atomic<size_t> m_bytes = 0;
+        std::atomic<size_t> m_hits = 0;
+        std::atomic<size_t> m_misses = 0;
+        std::atomic<size_t> m_evictions = 0;
     };
 }
@@ -4,6 +4,7 @@
 #include "Common/AsstConf.h"
 #include "Utils/NoWarningCV.h"
 #include <cstdint>
+#include <thread>
 
 #ifdef _MSC_VER
 #pragma warning(push)
@@ -179,6 +180,7 @@ std::optional<unsigned short> asst::AdbController::init_socket(const std::string
 void asst::AdbController::clear_info() noexcept
 {
     m_inited = false;
+    release_screencap_stream();
     m_adb = decltype(m_adb)();
     m_uuid.clear();
     m_width = 0;
@@ -276,6 +278,7 @@ std::pair<int, int> asst::AdbController::get_screen_res() const noexcept
 
 void asst::AdbController::release()
 {
+    release_screencap_stream();
     close_socket();
 
     if (m_kill_adb_on_exit && !m_adb.release.empty()) {
@@ -420,11 +423,40 @@ bool asst::AdbController::screencap(cv::Mat& image_payload, bool allow_reconnect
         else {
             Log.info("Encode is not supported");
         }
+        clear_lf_info();
+
+        // 启动常驻 shell 的开销只有一次，不计入单次截图耗时
+        if (!m_adb.screencap_stream_disabled && open_screencap_stream()) {
+            // 已经比别的方式慢了就没必要等满超时
+            const auto stream_timeout =
+                min_cost == milliseconds(LLONG_MAX) ? milliseconds(20000) : std::min(min_cost * 2, milliseconds(20000));
+            start_time = high_resolution_clock::now();
+            if (screencap_by_stream(decode_raw, stream_timeout)) {
+                auto duration = duration_cast<milliseconds>(high_resolution_clock::now() - start_time);
+                if (duration < min_cost) {
+                    m_adb.screencap_method = AdbProperty::ScreencapMethod::RawByStream;
+                    m_inited = true;
+                    min_cost = duration;
+                }
+                Log.info("RawByStream cost", duration.count(), "ms");
+            }
+            else {
+                Log.info("RawByStream is not supported");
+            }
+        }
+        else {
+            Log.info("RawByStream is not supported");
+        }
+        if (m_adb.screencap_method != AdbProperty::ScreencapMethod::RawByStream) {
+            release_screencap_stream();
+        }
+
         static const std::unordered_map<AdbProperty::ScreencapMethod, std::string> MethodName = {
             { AdbProperty::ScreencapMethod::UnknownYet, "UnknownYet" },
             { AdbProperty::ScreencapMethod::RawByNc, "RawByNc" },
             { AdbProperty::ScreencapMethod::RawWithGzip, "RawWithGzip" },
             { AdbProperty::ScreencapMethod::Encode, "Encode" },
+            { AdbProperty::ScreencapMethod::RawByStream, "RawByStream" },
         };
         Log.info("The fastest way is", MethodName.at(m_adb.screencap_method), ", cost:", min_cost.count(), "ms");
         clear_lf_info();
@@ -439,6 +471,24 @@ bool asst::AdbController::screencap(cv::Mat& image_payload, bool allow_reconnect
     case AdbProperty::ScreencapMethod::Encode: {
         return screencap(m_adb.screencap_encode, decode_encode, allow_reconnect);
     } break;
+    case AdbProperty::ScreencapMethod::RawByStream: {
+        if (screencap_by_stream(decode_raw)) {
+            m_adb.screencap_stream_failures = 0;
+            return true;
+        }
+        if (!allow_reconnect) {
+            return false;
+        }
+        // 常驻 shell 断了多半是 adb 出了问题。这一帧改用普通的截图命令，失败时和其他方式一样走重连；
+        // 下次截图会重新打开常驻 shell。连续失败太多次就不再用它，重新选一次最快的截图方式
+        if (++m_adb.screencap_stream_failures >= MaxScreencapStreamFailures) {
+            Log.warn("screencap stream keeps failing, disable RawByStream");
+            m_adb.screencap_stream_disabled = true;
+            m_adb.screencap_method = AdbProperty::ScreencapMethod::UnknownYet;
+            return screencap(image_payload, allow_reconnect);
+        }
+        return screencap(m_adb.screencap_encode, decode_encode, allow_reconnect);
+    } break;
     }
 
     return false;
@@ -503,6 +553,102 @@ bool asst::AdbController::screencap(const std::string& cmd, const DecodeFunc& de
     return true;
 }
 
+bool asst::AdbController::screencap_by_stream(const DecodeFunc& decode_func, std::chrono::milliseconds timeout)
+{
+    if (!m_screencap_stream_handler && !open_screencap_stream()) {
+        return false;
+    }
+
+    if (!m_screencap_stream_handler->write("screencap\n")) {
+        Log.error("failed to write to screencap stream");
+        release_screencap_stream();
+        return false;
+    }
+
+    using namespace std::chrono;
+    const size_t image_size = 4ULL * m_width * m_height;
+    // 头部长度未知时先读够 16 字节再判断
+    size_t header_size = m_adb.screencap_raw_header_size;
+    size_t total_size = header_size ? header_size + image_size : 16;
+
+    std::string data;
+    data.reserve(16 + image_size);
+
+    const auto start_time = steady_clock::now();
+    while (data.size() < total_size) {
+        if (need_exit() || steady_clock::now() - start_time > timeout) {
+            Log.error("screencap stream timeout, received", data.size(), "of", total_size);
+            release_screencap_stream();
+            return false;
+        }
+
+        std::string chunk = m_screencap_stream_handler->read(1);
+        if (chunk.empty()) {
+            // PosixIO 的管道是非阻塞的，没数据时会立即返回
+            std::this_thread::sleep_for(1ms);
+            continue;
+        }
+        data.append(chunk);
+
+        if (header_size == 0 && data.size() >= 16) {
+            // 老版本 screencap 的头部是 12 字节（w, h, format），紧接着就是第一个像素，其 alpha 为 255；
+            // 新版本多了 4 字节的 dataspace，其最高字节不会是 0xFF
+            header_size = static_cast<unsigned char>(data[15]) == 0xFF ? 12 : 16;
+            total_size = header_size + image_size;
+        }
+    }
+
+    // 多出来的数据说明流已经错位了，后面的帧都没法对齐，直接重开
+    if (data.size() != total_size) {
+        Log.error("screencap stream out of sync, received", data.size(), "expected", total_size);
+        release_screencap_stream();
+        return false;
+    }
+
+    if (!decode_func(data)) {
+        Log.error("screencap stream decode failed");
+        release_screencap_stream();
+        return false;
+    }
+
+    if (m_adb.screencap_raw_header_size == 0) {
+        Log.info("screencap raw header size is", header_size);
+        m_adb.screencap_raw_header_size = header_size;
+    }
+    return true;
+}
+
+bool asst::AdbController::open_screencap_stream()
+{
+    LogTraceFunction;
+
+    release_screencap_stream();
+
+    if (m_adb.screencap_raw_by_stream.empty() || m_width == 0 || m_height == 0) {
+        return false;
+    }
+
+    Log.info(m_adb.screencap_raw_by_stream);
+    m_screencap_stream_handler = m_platform_io->interactive_shell(m_adb.screencap_raw_by_stream);
+    if (!m_screencap_stream_handler) {
+        Log.error("unable to start screencap stream");
+        return false;
+    }
+
+    // stderr 和 stdout 可能是同一个流，屏蔽掉以免混进图像数据里
+    if (!m_screencap_stream_handler->write("exec 2>/dev/null\n")) {
+        Log.error("failed to write to screencap stream");
+        release_screencap_stream();
+        return false;
+    }
+    return true;
+}
+
+void asst::AdbController::release_screencap_stream() noexcept
+{
+    m_screencap_stream_handler.reset();
+}
+
 bool asst::AdbController::connect(const std::string& adb_path, const std::string& address, const std::string& config)
 {
     LogTraceFunction;
@@ -692,6 +838,7 @@ bool asst::AdbController::connect(const std::string& adb_path, const std::string
     m_adb.press_esc = cmd_replace(adb_cfg.press_esc);
     m_adb.screencap_raw_with_gzip = cmd_replace(adb_cfg.screencap_raw_with_gzip);
     m_adb.screencap_encode = cmd_replace(adb_cfg.screencap_encode);
+    m_adb.screencap_raw_by_stream = cmd_replace(adb_cfg.screencap_raw_by_stream);
     m_adb.start = cmd_replace(adb_cfg.start);
     m_adb.stop = cmd_replace(adb_cfg.stop);
 
@@ -2,6 +2,7 @@
 
 #include "ControllerAPI.h"
 
+#include <chrono>
 #include <random>
 
 #include "Platform/PlatformFactory.h"
@@ -62,6 +63,11 @@ namespace asst
         using DecodeFunc = std::function<bool(const std::string&)>;
         bool screencap(const std::string& cmd, const DecodeFunc& decode_func, bool allow_reconnect = false,
                        bool by_socket = false);
+        // 通过常驻的 shell 连续截图，省去每次截图都要新建 adb 连接、启动进程的开销
+        bool screencap_by_stream(const DecodeFunc& decode_func,
+                                 std::chrono::milliseconds timeout = std::chrono::seconds(20));
+        bool open_screencap_stream();
+        void release_screencap_stream() noexcept;
         void clear_lf_info();
 
         virtual void clear_info() noexcept;
@@ -78,6 +84,7 @@ namespace asst
         std::mutex m_callcmd_mutex;
 
         std::shared_ptr<asst::PlatformIO> m_platform_io = nullptr;
+        std::shared_ptr<asst::IOHandler> m_screencap_stream_handler = nullptr;
 
         struct AdbProperty
         {
@@ -92,6 +99,7 @@ namespace asst
             std::string screencap_raw_by_nc;
             std::string screencap_raw_with_gzip;
             std::string screencap_encode;
+            std::string screencap_raw_by_stream;
             std::string release;
 
             std::string start;
@@ -112,8 +120,13 @@ namespace asst
                 // Default,
                 RawByNc,
                 RawWithGzip,
-                Encode
+                Encode,
+                RawByStream
             } screencap_method = ScreencapMethod::UnknownYet;
+
+            size_t screencap_raw_header_size = 0; // 12 or 16, 0 means unknown yet
+            int screencap_stream_failures = 0;    // RawByStream 连续失败的次数
+            bool screencap_stream_disabled = false; // 连续失败太多次，不再使用 RawByStream
         } m_adb;
 
         std::string m_uuid;
@@ -124,5 +137,7 @@ namespace asst
         bool m_server_started = false;
         bool m_inited = false;
         bool m_kill_adb_on_exit = false;
+
+        static constexpr int MaxScreencapStreamFailures = 3;
     };
 } // namespace asst
@@ -23,6 +23,7 @@
 
 #include "Common/AsstTypes.h"
 #include "Utils/Logger.hpp"
+#include "Vision/FrameCache.h"
 
 asst::Controller::Controller(const AsstCallback& callback, Assistant* inst)
     : InstHelper(inst), m_callback(callback), m_rand_engine(std::random_device {}())
@@ -35,6 +36,9 @@ asst::Controller::Controller(const AsstCallback& callback, Assistant* inst)
 asst::Controller::~Controller()
 {
     LogTraceFunction;
+
+    stop_continuous_screencap();
+    FrameCache::get_instance().clear(this);
 }
 
 std::pair<int, int> asst::Controller::get_scale_size() const noexcept
@@ -74,58 +78,119 @@ cv::Mat asst::Controller::get_resized_image_cache() const
 {
     const static cv::Size d_size(m_scale_size.first, m_scale_size.second);
 
-    std::shared_lock<std::shared_mutex> image_lock(m_image_mutex);
-    if (m_cache_image.empty()) {
-        Log.error("image is empty");
-        return { d_size, CV_8UC3 };
+    cv::Mat image;
+    size_t image_id = 0;
+    {
+        std::shared_lock<std::shared_mutex> image_lock(m_image_mutex);
+        if (m_cache_image.empty()) {
+            Log.error("image is empty");
+            return { d_size, CV_8UC3 };
+        }
+        if (m_resized_image_id == m_cache_image_id && !m_resized_image.empty()) {
+            image = m_resized_image;
+            image_id = m_resized_image_id;
+        }
+    }
+
+    if (image.empty()) {
+        // 每一帧只缩放一次，之后的调用都共享同一张图
+        std::unique_lock<std::shared_mutex> image_lock(m_image_mutex);
+        if (m_resized_image_id != m_cache_image_id || m_resized_image.empty()) {
+            m_resized_image = resize_image(m_cache_image, d_size);
+            m_resized_image_id = m_cache_image_id;
+        }
+        image = m_resized_image;
+        image_id = m_resized_image_id;
+    }
+    // 只有交给识别器的帧才做派生图和识别结果的缓存
+    FrameCache::get_instance().add_frame(this, image_id, image);
+    return image;
+}
+
+cv::Mat asst::Controller::get_raw_image_cache() const
+{
+    cv::Mat image;
+    size_t image_id = 0;
+    {
+        std::shared_lock<std::shared_mutex> image_lock(m_image_mutex);
+        image = m_cache_image;
+        image_id = m_cache_image_id;
+    }
+    FrameCache::get_instance().add_frame(this, image_id, image);
+    return image;
+}
+
+cv::Mat asst::Controller::resize_image(const cv::Mat& image, const cv::Size& d_size)
+{
+    if (image.size() == d_size) {
+        return image;
     }
     cv::Mat resized_mat;
-    cv::resize(m_cache_image, resized_mat, d_size, 0.0, 0.0, cv::INTER_AREA);
+    cv::resize(image, resized_mat, d_size, 0.0, 0.0, cv::INTER_AREA);
     return resized_mat;
 }
 
+void asst::Controller::update_last_action_time() noexcept
+{
+    m_last_action_time = std::chrono::steady_clock::now();
+}
+
 bool asst::Controller::start_game(const std::string& client_type)
 {
     CHECK_EXIST(m_controller, false);
-    return m_controller->start_game(client_type);
+    bool ret = m_controller->start_game(client_type);
+    update_last_action_time();
+    return ret;
 }
 
 bool asst::Controller::stop_game()
 {
     CHECK_EXIST(m_controller, false);
-    return m_controller->stop_game();
+    bool ret = m_controller->stop_game();
+    update_last_action_time();
+    return ret;
 }
 
 bool asst::Controller::click(const Point& p)
 {
     CHECK_EXIST(m_controller, false);
-    return m_scale_proxy->click(p);
+    bool ret = m_scale_proxy->click(p);
+    update_last_action_time();
+    return ret;
 }
 
 bool asst::Controller::click(const Rect& rect)
 {
     CHECK_EXIST(m_controller, false);
-    return m_scale_proxy->click(rect);
+    bool ret = m_scale_proxy->click(rect);
+    update_last_action_time();
+    return ret;
 }
 
 bool asst::Controller::swipe(const Point& p1, const Point& p2, int duration, bool extra_swipe, double slope_in,
                              double slope_out, bool with_pause)
 {
     CHECK_EXIST(m_controller, false);
-    return m_scale_proxy->swipe(p1, p2, duration, extra_swipe, slope_in, slope_out, with_pause);
+    bool ret = m_scale_proxy->swipe(p1, p2, duration, extra_swipe, slope_in, slope_out, with_pause);
+    update_last_action_time();
+    return ret;
 }
 
 bool asst::Controller::swipe(const Rect& r1, const Rect& r2, int duration, bool extra_swipe, double slope_in,
                              double slope_out, bool with_pause)
 {
     CHECK_EXIST(m_controller, false);
-    return m_scale_proxy->swipe(r1, r2, duration, extra_swipe, slope_in, slope_out, with_pause);
+    bool ret = m_scale_proxy->swipe(r1, r2, duration, extra_swipe, slope_in, slope_out, with_pause);
+    update_last_action_time();
+    return ret;
 }
 
 bool asst::Controller::inject_input_event(InputEvent& event)
 {
     CHECK_EXIST(m_controller, false);
-    return m_controller->inject_input_event(event);
+    bool ret = m_controller->inject_input_event(event);
+    update_last_action_time();
+    return ret;
 }
 
 bool asst::Controller::press_esc()
@@ -133,7 +198,9 @@ bool asst::Controller::press_esc()
     LogTraceFunction;
 
     CHECK_EXIST(m_controller, false);
-    return m_controller->press_esc();
+    bool ret = m_controller->press_esc();
+    update_last_action_time();
+    return ret;
 }
 
 asst::ControlFeat::Feat asst::Controller::support_features()
@@ -146,6 +213,7 @@ bool asst::Controller::connect(const std::string& adb_path, const std::string& a
 {
     LogTraceFunction;
 
+    stop_continuous_screencap();
     clear_info();
 
     m_controller =
@@ -159,6 +227,7 @@ bool asst::Controller::connect(const std::string& adb_path, const std::string& a
     sync_params();
 
     m_uuid = m_controller->get_uuid();
+    m_delay_profile.load(m_uuid);
 
 #ifdef ASST_DEBUG
     if (config == "DEBUG") {
@@ -200,6 +269,10 @@ bool asst::Controller::connect(const std::string& adb_path, const std::string& a
 
     m_scale_size = m_scale_proxy->get_scale_size();
 
+    if (m_continuous_screencap) {
+        start_continuous_screencap();
+    }
+
     return true;
 }
 
@@ -246,6 +319,17 @@ void asst::Controller::set_kill_adb_on_exit(bool enable) noexcept
     sync_params();
 }
 
+void asst::Controller::set_continuous_screencap(bool enable)
+{
+    m_continuous_screencap = enable;
+    if (!enable) {
+        stop_continuous_screencap();
+    }
+    else if (m_controller && m_controller->inited()) {
+        start_continuous_screencap();
+    }
+}
+
 const std::string& asst::Controller::get_uuid() const
 {
     return m_uuid;
@@ -258,6 +342,15 @@ cv::Mat asst::Controller::get_image(bool raw)
         return {};
     }
 
+    if (m_screencap_thread_running) {
+        if (wait_continuous_image() || need_exit()) {
+            return raw ? get_raw_image_cache() : get_resized_image_cache();
+        }
+        // 后台截图卡住了，多半是 adb 出了问题，停下来走下面带重连的同步截图
+        Log.warn("continuous screencap timeout, fallback to sync screencap");
+        stop_continuous_screencap();
+    }
+
     // 有些模拟器adb偶尔会莫名其妙截图失败，多试几次
     static constexpr int MaxTryCount = 20;
     bool success = false;
@@ -272,6 +365,7 @@ cv::Mat asst::Controller::get_image(bool raw)
     }
     while (!success && !need_exit()) {
         if (screencap(true)) {
+            success = true;
             break;
         }
         Log.error(__FUNCTION__, "screencap failed!");
@@ -284,18 +378,36 @@ cv::Mat asst::Controller::get_image(bool raw)
         callback(AsstMsg::ConnectionInfo, info);
 
         const static cv::Size d_size(m_scale_size.first, m_scale_size.second);
+        std::unique_lock<std::shared_mutex> image_lock(m_image_mutex);
         m_cache_image = cv::Mat(d_size, CV_8UC3);
+        ++m_cache_image_id;
 
         break;
     }
 
-    if (raw) {
+    if (m_continuous_screencap && success) {
+        start_continuous_screencap();
+    }
+
+    return raw ? get_raw_image_cache() : get_resized_image_cache();
+}
+
+cv::Mat asst::Controller::get_image_newer_than(const std::chrono::steady_clock::time_point& time, bool raw)
+{
+    bool cache_valid = false;
+    {
         std::shared_lock<std::shared_mutex> image_lock(m_image_mutex);
-        cv::Mat copy = m_cache_image.clone();
-        return copy;
+        cache_valid = m_cache_image_id != 0 && !m_cache_image.empty() && m_cache_image_time >= time;
     }
+    if (!cache_valid) {
+        return get_image(raw);
+    }
+    return raw ? get_raw_image_cache() : get_resized_image_cache();
+}
 
-    return get_resized_image_cache();
+cv::Mat asst::Controller::get_image_after_action(bool raw)
+{
+    return get_image_newer_than(m_last_action_time, raw);
 }
 
 cv::Mat asst::Controller::get_image_cache() const
@@ -303,9 +415,121 @@ cv::Mat asst::Controller::get_image_cache() const
     return get_resized_image_cache();
 }
 
+size_t asst::Controller::get_image_id() const
+{
+    std::shared_lock<std::shared_mutex> image_lock(m_image_mutex);
+    return m_cache_image_id;
+}
+
+std::chrono::steady_clock::time_point asst::Controller::get_image_time() const
+{
+    std::shared_lock<std::shared_mutex> image_lock(m_image_mutex);
+    return m_cache_image_time;
+}
+
 bool asst::Controller::screencap(bool allow_reconnect)
 {
     CHECK_EXIST(m_controller, false);
+    if (m_screencap_thread_running && !need_exit()) {
+        // 后台线程正在截图，等它的下一帧就好
+        return wait_continuous_image();
+    }
+    std::unique_lock<std::mutex> screencap_lock(m_screencap_mutex);
+    // 以开始截图的时间作为这一帧的时间，保证该帧一定不早于此前的所有操作
+    const auto start_time = std::chrono::steady_clock::now();
+    // 截到一张新的 Mat 里再替换：尺寸不用缩放时 get_image 返回的就是 m_cache_image 本身，
+    // 若往它里面原地截图，调用方手上的旧帧和按帧缓存的派生图（FrameCache）都会被覆盖
+    cv::Mat image;
+    if (!m_controller->screencap(image, allow_reconnect)) {
+        return false;
+    }
+    std::unique_lock<std::shared_mutex> image_lock(m_image_mutex);
+    m_cache_image = std::move(image);
+    ++m_cache_image_id;
+    m_cache_image_time = start_time;
+    return true;
+}
+
+void asst::Controller::start_continuous_screencap()
+{
+    if (m_screencap_thread.joinable()) {
+        return;
+    }
+    LogTraceFunction;
+
+    m_screencap_thread_running = true;
+    m_screencap_thread = std::thread(&Controller::continuous_screencap_proc, this);
+}
+
+void asst::Controller::stop_continuous_screencap()
+{
+    m_screencap_thread_running = false;
+    m_image_condvar.notify_all();
+    if (m_screencap_thread.joinable()) {
+        m_screencap_thread.join();
+    }
+}
+
+void asst::Controller::continuous_screencap_proc()
+{
+    LogTraceFunction;
+
+    using namespace std::chrono_literals;
+    // 连接时已经确定了截图方式，这里持有一份，避免 connect 时被替换
+    const auto controller = m_controller;
+
+    while (m_screencap_thread_running) {
+        // 任务没在运行的时候不截图，省点资源
+        if (need_exit()) {
+            std::this_thread::sleep_for(100ms);
+            continue;
+        }
+
+        // 每次都截到一张新的 Mat 里，读者手上的旧帧仍然有效，不需要额外的拷贝
+        std::unique_lock<std::mutex> screencap_lock(m_screencap_mutex);
+        const auto start_time = std::chrono::steady_clock::now();
+        cv::Mat image;
+        bool ret = controller->screencap(image, false) && !image.empty();
+        screencap_lock.unlock();
+        if (!ret) {
+            std::this_thread::sleep_for(100ms);
+            continue;
+        }
+
+        // 顺便在这个线程里把缩放也做了，工作线程拿到就能直接用
+        const cv::Size d_size(m_scale_size.first, m_scale_size.second);
+        cv::Mat resized = resize_image(image, d_size);
+        {
+            std::unique_lock<std::shared_mutex> image_lock(m_image_mutex);
+            m_cache_image = std::move(image);
+            ++m_cache_image_id;
+            m_cache_image_time = start_time;
+            m_resized_image = std::move(resized);
+            m_resized_image_id = m_cache_image_id;
+        }
+        m_image_condvar.notify_all();
+    }
+}
+
+bool asst::Controller::wait_continuous_image()
+{
+    using namespace std::chrono_literals;
+    static constexpr auto Timeout = 10s;
+
     std::unique_lock<std::shared_mutex> image_lock(m_image_mutex);
-    return m_controller->screencap(m_cache_image, allow_reconnect);
+    // 需要的是上次操作之后才开始截的、且还没被取走过的一帧
+    const auto min_time = m_last_action_time;
+    auto is_ready = [&]() -> bool {
+        return m_cache_image_id > m_consumed_image_id && m_cache_image_time >= min_time;
+    };
+
+    const auto deadline = std::chrono::steady_clock::now() + Timeout;
+    while (!is_ready()) {
+        if (!m_screencap_thread_running || need_exit() || std::chrono::steady_clock::now() > deadline) {
+            return false;
+        }
+        m_image_condvar.wait_for(image_lock, 100ms);
+    }
+    m_consumed_image_id = m_cache_image_id;
+    return true;
 }
@@ -1,6 +1,10 @@
 #pragma once
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <memory>
+#include <mutex>
 #include <optional>
 #include <random>
 #include <shared_mutex>
@@ -18,6 +22,7 @@
 #include "ControllerFactory.h"
 
 #include "ControlScaleProxy.h"
+#include "DelayProfile.h"
 
 #include "Common/AsstMsg.h"
 #include "Common/AsstTypes.h"
@@ -44,10 +49,21 @@ namespace asst
         void set_swipe_with_pause(bool enable) noexcept;
         void set_adb_lite_enabled(bool enable) noexcept;
         void set_kill_adb_on_exit(bool enable) noexcept;
+        // 后台线程持续截图，get_image 直接取最新的一帧，截图与识别可以同时进行
+        void set_continuous_screencap(bool enable);
 
         const std::string& get_uuid() const;
+        // 当前设备的操作延迟档案，连接时按 uuid 加载
+        DelayProfile& delay_profile() noexcept { return m_delay_profile; }
+        // 返回的图像与截图缓存共享内存（同一帧只缩放一次），请当作只读使用，需要修改的话先 clone
         cv::Mat get_image(bool raw = false);
+        // 若缓存的截图是在 time 之后截取的，则直接复用缓存，否则重新截图
+        cv::Mat get_image_newer_than(const std::chrono::steady_clock::time_point& time, bool raw = false);
+        // 获取上一次操作（点击、滑动等）之后截取的图像
+        cv::Mat get_image_after_action(bool raw = false);
         cv::Mat get_image_cache() const;
+        size_t get_image_id() const;
+        std::chrono::steady_clock::time_point get_image_time() const;
         bool screencap(bool allow_reconnect = false);
 
         bool start_game(const std::string& client_type);
@@ -73,6 +89,14 @@ namespace asst
 
     private:
         cv::Mat get_resized_image_cache() const;
+        cv::Mat get_raw_image_cache() const;
+        static cv::Mat resize_image(const cv::Mat& image, const cv::Size& d_size);
+        void update_last_action_time() noexcept;
+
+        void start_continuous_screencap();
+        void stop_continuous_screencap();
+        void continuous_screencap_proc();
+        bool wait_continuous_image();
 
         void clear_info() noexcept;
         void callback(AsstMsg msg, const json::value& details);
@@ -93,6 +117,7 @@ namespace asst
         std::shared_ptr<ControlScaleProxy> m_scale_proxy = nullptr;
 
         std::string m_uuid;
+        DelayProfile m_delay_profile;
 
         std::pair<int, int> m_scale_size = { WindowWidthDefault, WindowHeightDefault };
 
@@ -101,5 +126,17 @@ namespace asst
 
         mutable std::shared_mutex m_image_mutex;
         cv::Mat m_cache_image;
+        size_t m_cache_image_id = 0; // 每次截图成功后自增，用于判断两张图是否是同一帧
+        mutable cv::Mat m_resized_image;
+        mutable size_t m_resized_image_id = 0; // m_resized_image 是由哪一帧缩放来的
+        std::chrono::steady_clock::time_point m_cache_image_time;
+        std::chrono::steady_clock::time_point m_last_action_time;
+
+        bool m_continuous_screencap = false;
+        std::mutex m_screencap_mutex; // 保证同一时刻只有一个线程在调用 m_controller->screencap
+        std::atomic_bool m_screencap_thread_running = false;
+        std::thread m_screencap_thread;
+        std::condition_variable_any m_image_condvar;
+        size_t m_consumed_image_id = 0; // 最后一次被 get_image 取走的图像 id
     };
 } // namespace asst
@@ -29,6 +29,8 @@ namespace asst
 
         virtual const std::string& get_uuid() const = 0;
 
+        // image_payload 必须指向新分配的缓冲区，不能往传入的 Mat 里原地写：
+        // 上一帧（及其未缩放时的同一份数据）可能还在被识别线程使用
         virtual bool screencap(cv::Mat& image_payload, bool allow_reconnect = false) = 0;
 
         virtual bool start_game(const std::string& client_type) = 0;
@@ -0,0 +1,147 @@
+#include "DelayProfile.h"
+
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+#include <vector>
+
+#include <meojson/json.hpp>
+
+#include "Config/GeneralConfig.h"
+#include "Utils/Logger.hpp"
+#include "Utils/WorkingDir.hpp"
+
+asst::DelayProfile::~DelayProfile()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    save_without_lock();
+}
+
+void asst::DelayProfile::load(const std::string& uuid)
+{
+    LogTraceFunction;
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    save_without_lock();
+    m_samples.clear();
+    m_path.clear();
+    m_unsaved = 0;
+
+    if (uuid.empty()) {
+        return;
+    }
+    // uuid 里可能有 ':' 之类不能做文件名的字符
+    std::string filename = uuid;
+    std::replace_if(
+        filename.begin(), filename.end(), [](char c) { return !std::isalnum(static_cast<unsigned char>(c)); }, '_');
+    m_path = UserDir.get() / "cache" / "DelayProfile" / utils::path(filename + ".json");
+
+    auto json_opt = json::open(m_path);
+    if (!json_opt || !json_opt->is_object()) {
+        Log.info("no delay profile for", uuid);
+        return;
+    }
+    for (const auto& [action, latencies_json] : json_opt->as_object()) {
+        if (!latencies_json.is_array()) {
+            continue;
+        }
+        auto& latencies = m_samples[action].latencies;
+        for (const auto& latency : latencies_json.as_array()) {
+            latencies.emplace_back(latency.as_integer());
+        }
+        while (latencies.size() > MaxSamples) {
+            latencies.pop_front();
+        }
+        Log.info("delay profile", action, "samples:", latencies.size(), "latency:", latency_without_lock(action));
+    }
+}
+
+void asst::DelayProfile::save()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    save_without_lock();
+}
+
+bool asst::DelayProfile::need_sample(const std::string& action)
+{
+    if (!Config.get_options().delay_calibration) {
+        return false;
+    }
+    std::unique_lock<std::mutex> lock(m_mutex);
+    auto& samples = m_samples[action];
+    if (samples.latencies.size() < MaxSamples || ++samples.skipped >= ResampleInterval) {
+        samples.skipped = 0;
+        return true;
+    }
+    return false;
+}
+
+void asst::DelayProfile::add_sample(const std::string& action, int latency)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    auto& latencies = m_samples[action].latencies;
+    latencies.emplace_back(latency);
+    if (latencies.size() > MaxSamples) {
+        latencies.pop_front();
+    }
+    if (++m_unsaved >= SaveInterval) {
+        save_without_lock();
+    }
+}
+
+int asst::DelayProfile::latency(const std::string& action) const
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    return latency_without_lock(action);
+}
+
+int asst::DelayProfile::scale(int delay, const std::string& action) const
+{
+    const auto& options = Config.get_options();
+    if (!options.delay_calibration || options.delay_calibration_reference <= 0 || delay <= 0) {
+        return delay;
+    }
+    int cur_latency = latency(action);
+    if (cur_latency < 0) {
+        return delay;
+    }
+    double ratio = static_cast<double>(cur_latency) / options.delay_calibration_reference;
+    return static_cast<int>(delay * std::clamp(ratio, MinScale, MaxScale));
+}
+
+void asst::DelayProfile::save_without_lock()
+{
+    if (m_path.empty() || m_unsaved == 0) {
+        return;
+    }
+    json::object profile_json;
+    for (const auto& [action, samples] : m_samples) {
+        if (samples.latencies.empty()) {
+            continue;
+        }
+        json::array latencies_json;
+        for (int latency : samples.latencies) {
+            latencies_json.emplace_back(latency);
+        }
+        profile_json.emplace(action, std::move(latencies_json));
+    }
+
+    std::filesystem::create_directories(m_path.parent_path());
+    std::ofstream osf(m_path);
+    osf << json::value(std::move(profile_json)).format();
+    osf.close();
+    m_unsaved = 0;
+}
+
+int asst::DelayProfile::latency_without_lock(const std::string& action) const
+{
+    auto iter = m_samples.find(action);
+    if (iter == m_samples.cend() || iter->second.latencies.size() < MinSamples) {
+        return -1;
+    }
+    // 取 90 分位数而不是平均值：偶尔卡一下的设备，按平均值缩放会经常等不够
+    std::vector<int> sorted(iter->second.latencies.cbegin(), iter->second.latencies.cend());
+    auto nth = sorted.begin() + static_cast<ptrdiff_t>(sorted.size() * 9 / 10);
+    std::nth_element(sorted.begin(), nth, sorted.end());
+    return *nth;
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <deque>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace asst
+{
+    // 设备的操作延迟档案：记录每类操作（点击、滑动等）从操作完成到画面出现变化的耗时，
+    // 按设备 uuid 保存在 UserDir/cache/DelayProfile 下，下次连接同一设备时直接沿用
+    // 任务的各种延时按测得的延迟相对参考延迟的比例缩放：设备快就少等一会，设备慢就多等一会
+    class DelayProfile
+    {
+    public:
+        static constexpr size_t MaxSamples = 50; // 每类操作只保留最近的这么多个样本
+        static constexpr size_t MinSamples = 10; // 样本不够时不缩放
+        static constexpr size_t SaveInterval = 10; // 每新增这么多个样本写一次文件
+        static constexpr size_t ResampleInterval = 20; // 样本攒够以后，每这么多次操作再采一次，跟上设备状态的变化
+        static constexpr double MinScale = 0.3;
+        static constexpr double MaxScale = 1.5;
+
+        DelayProfile() = default;
+        DelayProfile(const DelayProfile&) = delete;
+        DelayProfile(DelayProfile&&) = delete;
+        ~DelayProfile();
+
+        // 切换到另一台设备，先保存当前设备的档案
+        void load(const std::string& uuid);
+        void save();
+
+        // 本次 action 类操作是否需要测一下延迟，会计数，每次操作调用一次
+        bool need_sample(const std::string& action);
+        void add_sample(const std::string& action, int latency);
+        // 延迟的 90 分位数，样本不足时返回 -1
+        int latency(const std::string& action) const;
+        // 按 latency / reference 缩放延时，未开启校准或样本不足时原样返回
+        int scale(int delay, const std::string& action) const;
+
+        DelayProfile& operator=(const DelayProfile&) = delete;
+        DelayProfile& operator=(DelayProfile&&) = delete;
+
+    private:
+        struct Samples
+        {
+            std::deque<int> latencies;
+            size_t skipped = 0; // 上次采样之后又执行过多少次
+        };
+
+        void save_without_lock();
+        int latency_without_lock(const std::string& action) const;
+
+        mutable std::mutex m_mutex;
+        std::filesystem::path m_path;
+        std::unordered_map<std::string, Samples> m_samples;
+        size_t m_unsaved = 0;
+    };
+}
@@ -274,7 +274,8 @@ bool asst::MaaThriftController::screencap(cv::Mat& image_payload, [[maybe_unused
         return false;
     }
     cv::Mat orig_mat(img.size.height, img.size.width, img.type, img.data.data());
-    orig_mat.copyTo(image_payload);
+    // 不能 copyTo：image_payload 若是上一帧，会把调用方还拿着的图原地覆盖掉
+    image_payload = orig_mat.clone();
     return true;
 }
 
@@ -369,19 +369,25 @@ std::string asst::IOHandlerWin32::read(unsigned timeout_sec)
     OVERLAPPED pipeov { .hEvent = CreateEventW(nullptr, TRUE, FALSE, nullptr) };
     std::ignore = ReadFile(m_read, pipe_buffer.get(), PipeBufferSize, nullptr, &pipeov);
 
+    DWORD len = 0;
     while (true) {
         if (!check_timeout(start_time)) {
             CancelIoEx(m_read, &pipeov);
+            // 等取消完成，取消前可能已经读到了一部分
+            if (!GetOverlappedResult(m_read, &pipeov, &len, TRUE)) {
+                len = 0;
+            }
             Log.error("read timeout");
             break;
         }
-        DWORD len = 0;
         if (GetOverlappedResult(m_read, &pipeov, &len, FALSE)) {
             break;
         }
     }
+    CloseHandle(pipeov.hEvent);
 
-    return pipe_buffer.get();
+    // 按实际读到的长度构造，不能当 C 字符串：截图流等二进制数据里会有 '\0'
+    return std::string(pipe_buffer.get(), len);
 }
 
 bool asst::IOHandlerWin32::write(std::string_view data)
@@ -89,7 +89,7 @@ namespace adb
 
     std::string io_handle_impl::read(unsigned timeout)
     {
-        std::array<char, 1024> buffer;
+        std::array<char, 64 * 1024> buffer;
 
         if (timeout == 0) {
             const auto bytes_read = m_socket.read_some(asio::buffer(buffer));
@@ -3,7 +3,9 @@
 #include <memory>
 #include <meojson/json.hpp>
 #include <set>
+#include <string>
 #include <type_traits>
+#include <vector>
 
 #include "Common/AsstMsg.h"
 #include "InstHelper.h"
@@ -54,6 +56,8 @@ namespace asst
         std::string_view get_task_chain() const noexcept { return m_task_chain; }
         int get_task_id() const noexcept { return m_task_id; }
         virtual json::value basic_info() const;
+        // 任务从 tasks.json 中的哪些任务开始执行，用于预先加载会用到的模板。不是按 tasks.json 流程执行的返回空
+        virtual std::vector<std::string> get_entry_tasks() const { return {}; }
 
         static constexpr int RetryTimesDefault = 20;
 
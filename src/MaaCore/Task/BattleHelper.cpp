@@ -3,6 +3,7 @@
 #include <future>
 #include <thread>
 
+#include "Config/GeneralConfig.h"
 #include "Config/Miscellaneous/AvatarCacheManager.h"
 #include "Config/Miscellaneous/BattleDataConfig.h"
 #include "Config/TaskData.h"
@@ -14,6 +15,7 @@
 #include "Vision/Battle/BattlefieldClassifier.h"
 #include "Vision/Battle/BattlefieldMatcher.h"
 #include "Vision/BestMatcher.h"
+#include "Vision/FrameChangeDetector.h"
 #include "Vision/Matcher.h"
 #include "Vision/RegionOCRer.h"
 
@@ -99,6 +101,7 @@ bool asst::BattleHelper::update_deployment(bool init, const cv::Mat& reusable)
 
     BattlefieldMatcher oper_analyzer(image);
     oper_analyzer.set_object_of_interest({ .deployment = true });
+    oper_analyzer.set_threads(Config.get_options().battlefield_analyze_threads);
     auto oper_result_opt = oper_analyzer.analyze();
     if (!oper_result_opt) {
         check_in_battle(image);
@@ -128,29 +131,75 @@ bool asst::BattleHelper::update_deployment(bool init, const cv::Mat& reusable)
     auto& cur_opers = oper_result_opt->deployment;
     std::vector<DeploymentOper> unknown_opers;
 
+    // 粗筛后只对最像的这么多个头像做精确匹配，0 为不粗筛；
+    // 缩略图得分只是近似，精确匹配的得分要比没入选头像的缩略图得分高出 margin（百分之）才采信，否则全量匹配
+    static const auto avatar_candidate_params = Task.get("BattleAvatarData")->special_params;
+    static const size_t avatar_candidates_count = static_cast<size_t>(avatar_candidate_params.at(0));
+    static const double avatar_candidate_margin = avatar_candidate_params.at(1) / 100.0;
+
     for (auto& oper : cur_opers) {
-        BestMatcher avatar_analyzer(oper.avatar);
         if (oper.cooling) {
             Log.trace("start matching cooling", oper.index);
+        }
+        auto& avatar_cache = AvatarCache.get_avatars(oper.role);
+
+        double threshold = 0;
+        if (oper.cooling) {
             static const double cooling_threshold =
                 Task.get<MatchTaskInfo>("BattleAvatarCoolingData")->templ_thresholds.front();
-            static const auto cooling_mask_range = Task.get<MatchTaskInfo>("BattleAvatarCoolingData")->mask_range;
-            avatar_analyzer.set_threshold(cooling_threshold);
-            avatar_analyzer.set_mask_range(cooling_mask_range.first, cooling_mask_range.second, true, true);
+            threshold = cooling_threshold;
         }
         else {
-            static const double threshold = Task.get<MatchTaskInfo>("BattleAvatarData")->templ_thresholds.front();
+            static const double avatar_threshold =
+                Task.get<MatchTaskInfo>("BattleAvatarData")->templ_thresholds.front();
             static const double drone_threshold =
                 Task.get<MatchTaskInfo>("BattleDroneAvatarData")->templ_thresholds.front();
-            avatar_analyzer.set_threshold(oper.role == Role::Drone ? drone_threshold : threshold);
+            threshold = oper.role == Role::Drone ? drone_threshold : avatar_threshold;
         }
 
-        auto& avatar_cache = AvatarCache.get_avatars(oper.role);
-        for (const auto& [name, avatar] : avatar_cache) {
-            avatar_analyzer.append_templ(name, avatar);
+        // names 为空表示和该职业的所有头像做匹配
+        auto match_avatar = [&](const std::vector<std::string>& names) -> BestMatcher::ResultOpt {
+            BestMatcher avatar_analyzer(oper.avatar);
+            avatar_analyzer.set_threshold(threshold);
+            if (oper.cooling) {
+                static const auto cooling_mask_range =
+                    Task.get<MatchTaskInfo>("BattleAvatarCoolingData")->mask_range;
+                avatar_analyzer.set_mask_range(cooling_mask_range.first, cooling_mask_range.second, true, true);
+            }
+
+            if (names.empty()) {
+                for (const auto& [name, avatar] : avatar_cache) {
+                    avatar_analyzer.append_templ(name, avatar);
+                }
+            }
+            else {
+                for (const auto& name : names) {
+                    avatar_analyzer.append_templ(name, avatar_cache.at(name));
+                }
+            }
+            return avatar_analyzer.analyze();
+        };
+
+        std::optional<std::string> matched_name;
+        // 冷却中的头像是暗的，还带了掩码，缩略图粗筛不可靠，直接全量匹配
+        if (!oper.cooling && avatar_candidates_count != 0 && avatar_cache.size() > avatar_candidates_count) {
+            auto candidates = AvatarCache.get_avatar_candidates(oper.role, oper.avatar, avatar_candidates_count);
+            if (!candidates.names.empty()) {
+                // 没入选的头像精确匹配也可能更高，只有明显比它们都像时才采信，否则全量匹配再确认一次
+                auto result_opt = match_avatar(candidates.names);
+                if (result_opt && result_opt->score >= candidates.rest_score + avatar_candidate_margin) {
+                    matched_name = result_opt->templ_info.name;
+                }
+            }
+        }
+        if (!matched_name) {
+            if (auto result_opt = match_avatar({})) {
+                matched_name = result_opt->templ_info.name;
+            }
         }
-        if (avatar_analyzer.analyze()) {
-            set_oper_name(oper, avatar_analyzer.get_result().templ_info.name);
+
+        if (matched_name) {
+            set_oper_name(oper, *matched_name);
             m_cur_deployment_opers.insert_or_assign(oper.name, oper);
             remove_cooling_from_battlefield(oper);
         }
@@ -227,7 +276,8 @@ bool asst::BattleHelper::update_deployment(bool init, const cv::Mat& reusable)
 
 bool asst::BattleHelper::update_kills(const cv::Mat& reusable)
 {
-    cv::Mat image = reusable.empty() ? m_inst_helper.ctrler()->get_image() : reusable;
+    // 只要是上次操作之后的截图就可以了，没必要为此再截一次图
+    cv::Mat image = reusable.empty() ? m_inst_helper.ctrler()->get_image_after_action() : reusable;
     BattlefieldMatcher analyzer(image);
     analyzer.set_object_of_interest({ .kills = true });
     if (m_total_kills) {
@@ -243,7 +293,8 @@ bool asst::BattleHelper::update_kills(const cv::Mat& reusable)
 
 bool asst::BattleHelper::update_cost(const cv::Mat& reusable)
 {
-    cv::Mat image = reusable.empty() ? m_inst_helper.ctrler()->get_image() : reusable;
+    // 只要是上次操作之后的截图就可以了，没必要为此再截一次图
+    cv::Mat image = reusable.empty() ? m_inst_helper.ctrler()->get_image_after_action() : reusable;
     BattlefieldMatcher analyzer(image);
     analyzer.set_object_of_interest({ .costs = true });
     auto result_opt = analyzer.analyze();
@@ -422,27 +473,44 @@ bool asst::BattleHelper::wait_until_start(bool weak)
 {
     LogTraceFunction;
 
-    cv::Mat image = m_inst_helper.ctrler()->get_image();
-    while (!m_inst_helper.need_exit() && !check_in_battle(image, weak)) {
-        do_strategic_action(image);
-        std::this_thread::yield();
-
-        image = m_inst_helper.ctrler()->get_image();
-    }
-    return true;
+    return wait_until_battle_state_changes(false, weak);
 }
 
 bool asst::BattleHelper::wait_until_end(bool weak)
 {
     LogTraceFunction;
 
+    return wait_until_battle_state_changes(true, weak);
+}
+
+bool asst::BattleHelper::wait_until_battle_state_changes(bool in_battle, bool weak)
+{
+    // 画面完全没变、上一轮也没开技能的话，战斗状态和技能识别的结果都不会变，跳过这一帧
+    // check_in_battle 里可能会点跳过剧情之类的按钮，万一没点上画面也不会变，所以连续跳过若干帧后强制识别一次
+    static constexpr int MaxSkippedInRow = 5;
+    FrameChangeDetector frame_detector;
+    bool acted = false;
+    int skipped_in_row = 0;
+
     cv::Mat image = m_inst_helper.ctrler()->get_image();
-    while (!m_inst_helper.need_exit() && check_in_battle(image, weak)) {
-        do_strategic_action(image);
+    while (!m_inst_helper.need_exit()) {
+        const bool changed = frame_detector.changed(image);
+        if (acted || changed || skipped_in_row >= MaxSkippedInRow) {
+            skipped_in_row = 0;
+            if (check_in_battle(image, weak) != in_battle) {
+                break;
+            }
+            acted = do_strategic_action(image);
+        }
+        else {
+            ++skipped_in_row;
+        }
         std::this_thread::yield();
 
         image = m_inst_helper.ctrler()->get_image();
     }
+    Log.info(__FUNCTION__, "| unchanged frames skipped", frame_detector.unchanged_count(), "/",
+             frame_detector.checked_count());
     return true;
 }
 
@@ -454,37 +522,63 @@ bool asst::BattleHelper::do_strategic_action(const cv::Mat& reusable)
 
 bool asst::BattleHelper::use_all_ready_skill(const cv::Mat& reusable)
 {
-    bool used = false;
-    cv::Mat image = reusable.empty() ? m_inst_helper.ctrler()->get_image() : reusable;
+    std::vector<std::pair<std::string, Point>> candidates;
+    std::vector<Point> base_points;
     for (const auto& [name, loc] : m_battlefield_opers) {
-        auto& usage = m_skill_usage[name];
-        auto& retry = m_skill_error_count[name];
-        auto& times = m_skill_times[name];
+        auto usage = m_skill_usage[name];
         if (usage != SkillUsage::Possibly && usage != SkillUsage::Times) {
             continue;
         }
-        bool has_error = false;
-        if (!check_and_use_skill(loc, has_error, image)) {
+        auto target_iter = m_normal_tile_info.find(loc);
+        if (target_iter == m_normal_tile_info.end()) {
+            Log.error("No loc", loc);
             continue;
         }
-        // 识别到了，但点进去发现没有。一般来说是识别错了
-        if (has_error) {
-            Log.warn("Skill", name, "is not ready");
-            constexpr int MaxRetry = 3;
-            if (++retry >= MaxRetry) {
-                Log.warn("Do not use skill anymore", name);
-                usage = SkillUsage::NotUse;
+        candidates.emplace_back(name, loc);
+        base_points.emplace_back(target_iter->second.pos);
+    }
+
+    bool used = false;
+    cv::Mat image = reusable.empty() ? m_inst_helper.ctrler()->get_image() : reusable;
+    // 所有干员一次推理识别完；开了技能之后画面会变，后面的干员要在新截图上重新识别
+    size_t begin = 0;
+    while (begin < candidates.size()) {
+        BattlefieldClassifier skill_analyzer(image);
+        auto results =
+            skill_analyzer.batch_skill_ready_analyze(std::vector<Point>(base_points.begin() + begin, base_points.end()));
+
+        size_t next_begin = candidates.size();
+        for (size_t i = begin; i < candidates.size(); ++i) {
+            if (!results[i - begin].ready) {
+                continue;
             }
-            continue;
-        }
-        used = true;
-        retry = 0;
+            const auto& [name, loc] = candidates[i];
+            auto& usage = m_skill_usage[name];
+            auto& retry = m_skill_error_count[name];
+            auto& times = m_skill_times[name];
+
+            // 识别到了，但点进去发现没有。一般来说是识别错了
+            if (!use_skill(loc, false)) {
+                Log.warn("Skill", name, "is not ready");
+                constexpr int MaxRetry = 3;
+                if (++retry >= MaxRetry) {
+                    Log.warn("Do not use skill anymore", name);
+                    usage = SkillUsage::NotUse;
+                }
+                continue;
+            }
+            used = true;
+            retry = 0;
 
-        if (usage == SkillUsage::Times) {
-            times--;
-            if (times == 0) usage = SkillUsage::TimesUsed;
+            if (usage == SkillUsage::Times) {
+                times--;
+                if (times == 0) usage = SkillUsage::TimesUsed;
+            }
+            image = m_inst_helper.ctrler()->get_image();
+            next_begin = i + 1;
+            break;
         }
-        image = m_inst_helper.ctrler()->get_image();
+        begin = next_begin;
     }
 
     return used;
@@ -49,6 +49,8 @@ namespace asst
         virtual bool check_in_battle(const cv::Mat& reusable = cv::Mat(), bool weak = true);
         virtual bool wait_until_start(bool weak = true);
         bool wait_until_end(bool weak = true);
+        // 一直等到 check_in_battle 的结果不再是 in_battle，期间不断尝试开技能
+        bool wait_until_battle_state_changes(bool in_battle, bool weak);
         bool use_all_ready_skill(const cv::Mat& reusable = cv::Mat());
         bool check_and_use_skill(const std::string& name, bool& has_error, const cv::Mat& reusable = cv::Mat());
         bool check_and_use_skill(const Point& loc, bool& has_error, const cv::Mat& reusable = cv::Mat());
@@ -1,5 +1,6 @@
 #include "CombatRecordRecognitionTask.h"
 
+#include "Config/GeneralConfig.h"
 #include "Config/Miscellaneous/BattleDataConfig.h"
 #include "Config/Miscellaneous/TilePack.h"
 #include "Config/TaskData.h"
@@ -360,6 +361,7 @@ bool asst::CombatRecordRecognitionTask::slice_video()
             .kills = true,
             .speed_button = true,
         });
+        analyzer.set_threads(Config.get_options().battlefield_analyze_threads);
 
         analyzer.set_total_kills_prompt(total_kills);
         auto result_opt = analyzer.analyze();
@@ -55,8 +55,9 @@ void asst::SanityBeforeStagePlugin::get_sanity_before_stage()
         Log.info(__FUNCTION__, "Current Sanity analyze failed");
 
         std::string stem = utils::get_time_filestem();
-        cv::rectangle(img, make_rect<cv::Rect>(Task.get("SanityMatch")->roi), cv::Scalar(0, 0, 255), 2);
-        imwrite(utils::path("debug") / utils::path("sanity") / (stem + "_failed_img.png"), img);
+        cv::Mat draw = img.clone();
+        cv::rectangle(draw, make_rect<cv::Rect>(Task.get("SanityMatch")->roi), cv::Scalar(0, 0, 255), 2);
+        imwrite(utils::path("debug") / utils::path("sanity") / (stem + "_failed_img.png"), draw);
         return;
     }
     std::string text = analyzer.get_result().text;
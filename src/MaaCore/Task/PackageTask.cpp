@@ -1,5 +1,7 @@
 #include "InterfaceTask.h"
 
+#include <iterator>
+
 #include "Config/GeneralConfig.h"
 #include "Utils/Logger.hpp"
 
@@ -45,6 +47,20 @@ asst::AbstractTask& asst::PackageTask::set_retry_times(int times) noexcept
     return *this;
 }
 
+std::vector<std::string> asst::PackageTask::get_entry_tasks() const
+{
+    std::vector<std::string> entries;
+    for (const auto& sub : m_subtasks) {
+        if (!sub->get_enable()) {
+            continue;
+        }
+        auto sub_entries = sub->get_entry_tasks();
+        entries.insert(entries.end(), std::make_move_iterator(sub_entries.begin()),
+                       std::make_move_iterator(sub_entries.end()));
+    }
+    return entries;
+}
+
 asst::AbstractTask& asst::PackageTask::set_task_id(int task_id) noexcept
 {
     AbstractTask::set_task_id(task_id);
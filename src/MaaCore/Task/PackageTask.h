@@ -18,6 +18,7 @@ namespace asst
 
         virtual AbstractTask& set_retry_times(int times) noexcept override;
         virtual AbstractTask& set_task_id(int task_id) noexcept override;
+        virtual std::vector<std::string> get_entry_tasks() const override;
 
     protected:
         virtual bool _run() override { return true; }
@@ -1,7 +1,9 @@
 #include "ProcessTask.h"
 
+#include <algorithm>
 #include <chrono>
 #include <random>
+#include <thread>
 #include <unordered_set>
 
 #include <meojson/json.hpp>
@@ -9,6 +11,7 @@
 #include "Config/GeneralConfig.h"
 #include "Config/TaskData.h"
 #include "Controller/Controller.h"
+#include "Controller/DelayProfile.h"
 #include "Status.h"
 #include "Utils/Logger.hpp"
 #include "Vision/Miscellaneous/PipelineAnalyzer.h"
@@ -120,17 +123,34 @@ bool ProcessTask::_run()
         // 如果第一个任务是JustReturn的，那就没必要再截图并计算了
         if (front_task_ptr->algorithm == AlgorithmType::JustReturn) {
             m_cur_task_ptr = front_task_ptr;
+            m_action_frame = cv::Mat();
         }
         else {
             cv::Mat image = m_reusable.empty() ? ctrler()->get_image() : m_reusable;
             m_reusable = cv::Mat();
+            m_action_frame = image;
+
+            const bool same_tasks = m_unmatched_tasks == m_cur_task_name_list;
+            if (same_tasks && !m_unmatched_frame.changed(image)) {
+                Log.info("frame unchanged since last failure, skip analyzing | skipped",
+                         m_unmatched_frame.unchanged_count(), "/", m_unmatched_frame.checked_count());
+                return false;
+            }
+
             PipelineAnalyzer analyzer(image, Rect(), m_inst);
             analyzer.set_tasks(m_cur_task_name_list);
+            analyzer.set_threads(Config.get_options().pipeline_analyze_threads);
 
             auto res_opt = analyzer.analyze();
             if (!res_opt) {
+                if (!same_tasks) {
+                    m_unmatched_tasks = m_cur_task_name_list;
+                    m_unmatched_frame = FrameChangeDetector(union_roi(m_unmatched_tasks));
+                    m_unmatched_frame.changed(image);
+                }
                 return false;
             }
+            m_unmatched_tasks.clear();
             m_cur_task_ptr = res_opt->task_ptr;
             rect = res_opt->rect;
         }
@@ -176,17 +196,30 @@ bool ProcessTask::_run()
 
         callback(AsstMsg::SubTaskStart, info);
 
+        // 各种延时按设备实测的操作延迟缩放，未开启延时校准时原样返回
+        const std::string action_name = enum_to_string(m_cur_task_ptr->action);
+        DelayProfile& delay_profile = ctrler()->delay_profile();
+
         // 前置固定延时
-        if (!sleep(m_cur_task_ptr->pre_delay)) {
+        if (!wait_until_stable(delay_profile.scale(m_cur_task_ptr->pre_delay, action_name), {}, false)) {
             return false;
         }
 
+        // 要测延迟的话，紧挨着动作之前截一张图作参照。识别用的画面加上前置延时可能已经是很久之前的了，
+        // 这期间画面自己的变化会被当成动作的反应
+        cv::Mat sample_frame;
+        if (is_sampleable(m_cur_task_ptr->action) && delay_profile.need_sample(action_name)) {
+            sample_frame = ctrler()->get_image();
+        }
+
         bool need_stop = false;
+        Rect action_rect; // 动作作用的区域，为空表示全屏
         switch (m_cur_task_ptr->action) {
         case ProcessTaskAction::ClickRect:
             rect = m_cur_task_ptr->specific_rect;
             [[fallthrough]];
         case ProcessTaskAction::ClickSelf:
+            action_rect = rect;
             exec_click_task(rect);
             break;
         case ProcessTaskAction::ClickRand: {
@@ -195,6 +228,7 @@ bool ProcessTask::_run()
             exec_click_task(full_rect);
         } break;
         case ProcessTaskAction::Swipe:
+            action_rect = m_cur_task_ptr->specific_rect;
             exec_swipe_task(m_cur_task_ptr->specific_rect, m_cur_task_ptr->rect_move,
                             m_cur_task_ptr->special_params.empty() ? 0 : m_cur_task_ptr->special_params.at(0),
                             (m_cur_task_ptr->special_params.size() < 2) ? false : m_cur_task_ptr->special_params.at(1),
@@ -211,6 +245,17 @@ bool ProcessTask::_run()
             break;
         }
 
+        // 顺便测一下这次操作多久之后画面才有反应。本来就要等后置延时和任务间延时，
+        // 测量用掉的时间先从后置延时里扣，不够扣的再从任务间延时里扣，不会重复等
+        const int post_delay = delay_profile.scale(calc_post_delay(), action_name);
+        const int task_delay = delay_profile.scale(m_task_delay, action_name);
+        int sampled_time = 0;
+        if (!sample_frame.empty()) {
+            sampled_time =
+                sample_action_latency(action_name, sample_frame, sample_roi(action_rect), post_delay + task_delay);
+        }
+        const int task_delay_used = std::max(sampled_time - post_delay, 0);
+
         status()->set_number(Status::ProcessTaskLastTimePrefix + m_last_task_name, time(nullptr));
 
         // 减少其他任务的执行次数
@@ -229,7 +274,9 @@ bool ProcessTask::_run()
         }
 
         // 后置固定延时
-        if (!sleep(calc_post_delay())) {
+        // 有 sub 时接下来识别的是 sub 的任务，不知道要等什么，只看画面是否稳定
+        if (!wait_until_stable(std::max(post_delay - sampled_time, 0),
+                               m_cur_task_ptr->sub.empty() ? m_cur_task_ptr->next : std::vector<std::string> {})) {
             return false;
         }
 
@@ -258,7 +305,7 @@ bool ProcessTask::_run()
             Log.info("exec times exceeded the limit", info.to_string());
             callback(AsstMsg::SubTaskExtraInfo, info);
             m_cur_task_name_list = m_cur_task_ptr->exceeded_next;
-            sleep(m_task_delay);
+            sleep(std::max(task_delay - task_delay_used, 0));
             continue;
         }
 
@@ -270,7 +317,7 @@ bool ProcessTask::_run()
             return true;
         }
         m_cur_task_name_list = m_cur_task_ptr->next;
-        sleep(m_task_delay);
+        wait_until_stable(std::max(task_delay - task_delay_used, 0), m_cur_task_name_list);
     }
 
     return true;
@@ -288,6 +335,164 @@ bool asst::ProcessTask::on_run_fails()
     return run();
 }
 
+bool asst::ProcessTask::wait_until_stable(int max_delay, const std::vector<std::string>& next_tasks,
+                                          bool require_change)
+{
+    using namespace std::chrono;
+    // 轮询的间隔；延时本来就没比它长多少的，直接睡就好
+    constexpr milliseconds PollInterval(100);
+    // 连续这么多帧没有变化才认为画面稳定了
+    constexpr int StableRounds = 2;
+
+    if (!Config.get_options().adaptive_delay || m_action_frame.empty() || milliseconds(max_delay) < PollInterval * 2) {
+        return sleep(max_delay);
+    }
+    // 上一段等待已经等到了可以直接识别的画面（比如后置延时之后紧接着的任务间延时），不用再等
+    if (!next_tasks.empty() && !m_reusable.empty()) {
+        return !need_exit();
+    }
+
+    // 等待期间只拿模板匹配的任务试探，OCR 太慢，不值得每一轮都跑；
+    // 而且只取排在最前面的一串，否则前面的 OCR 任务还没识别到时，后面的任务先匹配上就会抢了它的位置
+    std::vector<std::string> probe_tasks;
+    for (const std::string& name : next_tasks) {
+        auto task_ptr = Task.get(name);
+        if (!task_ptr || task_ptr->algorithm != AlgorithmType::MatchTemplate) {
+            break;
+        }
+        probe_tasks.emplace_back(name);
+    }
+
+    const auto start_time = steady_clock::now();
+    const auto deadline = start_time + milliseconds(max_delay);
+    // 整屏按块求均值后比较，比逐像素比较便宜得多，也不受编码噪声影响
+    const cv::Mat action_signature = FrameChangeDetector::make_signature(m_action_frame);
+    cv::Mat pre_signature = action_signature;
+    bool changed = !require_change;
+    int stable_rounds = 0;
+
+    while (steady_clock::now() + PollInterval < deadline) {
+        const auto poll_time = steady_clock::now();
+        std::this_thread::sleep_for(PollInterval);
+        if (need_exit()) {
+            return false;
+        }
+        cv::Mat image = ctrler()->get_image_newer_than(poll_time);
+        cv::Mat signature = FrameChangeDetector::make_signature(image);
+        changed = changed || !FrameChangeDetector::is_similar(signature, action_signature);
+        stable_rounds = FrameChangeDetector::is_similar(signature, pre_signature) ? stable_rounds + 1 : 0;
+        pre_signature = std::move(signature);
+        // 画面还在动，或者动作还没生效，接着等
+        if (!changed || stable_rounds == 0) {
+            continue;
+        }
+
+        bool done = stable_rounds >= StableRounds;
+        if (!done && !probe_tasks.empty()) {
+            // 下一步的任务已经能识别到了，就不用再等了
+            // 只是试探，不传实例，不读也不写任务状态里缓存的识别区域
+            PipelineAnalyzer analyzer(image);
+            analyzer.set_tasks(probe_tasks);
+            analyzer.set_threads(Config.get_options().pipeline_analyze_threads);
+            done = analyzer.analyze().has_value();
+        }
+        if (done) {
+            if (!next_tasks.empty()) {
+                m_reusable = image;
+            }
+            Log.trace(__FUNCTION__, "stable after",
+                      duration_cast<milliseconds>(steady_clock::now() - start_time).count(), "ms, max", max_delay);
+            return true;
+        }
+    }
+
+    const auto rest = deadline - steady_clock::now();
+    if (rest > milliseconds::zero()) {
+        return sleep(static_cast<unsigned>(duration_cast<milliseconds>(rest).count()));
+    }
+    return !need_exit();
+}
+
+bool asst::ProcessTask::is_sampleable(ProcessTaskAction action) noexcept
+{
+    switch (action) {
+    case ProcessTaskAction::ClickSelf:
+    case ProcessTaskAction::ClickRect:
+    case ProcessTaskAction::ClickRand:
+    case ProcessTaskAction::Swipe:
+        return true;
+    default:
+        return false;
+    }
+}
+
+int asst::ProcessTask::sample_action_latency(const std::string& action, const cv::Mat& ref_frame, const Rect& roi,
+                                             int max_wait)
+{
+    using namespace std::chrono;
+
+    const auto start_time = steady_clock::now();
+    const cv::Mat ref_signature = FrameChangeDetector::make_signature(ref_frame, roi);
+
+    while (!need_exit() && steady_clock::now() < start_time + milliseconds(max_wait)) {
+        // 每次都要求新截一张图，截图本身的耗时就是采样的间隔
+        const auto poll_time = steady_clock::now();
+        cv::Mat image = ctrler()->get_image_newer_than(poll_time);
+        if (image.empty()) {
+            break;
+        }
+        const auto capture_interval = steady_clock::now() - poll_time;
+        if (FrameChangeDetector::is_similar(FrameChangeDetector::make_signature(image, roi), ref_signature)) {
+            continue;
+        }
+        // 用这一帧开始截图的时间来算，不把截图本身的耗时算进延迟里
+        const auto latency = std::max(ctrler()->get_image_time(), start_time) - start_time;
+        const int latency_ms = static_cast<int>(duration_cast<milliseconds>(latency).count());
+        // 一个截图间隔之内就变了，只知道延迟比截图间隔短，测不准，不记录
+        if (latency < capture_interval) {
+            Log.trace(__FUNCTION__, action, "latency", latency_ms, "ms, shorter than capture interval, discard");
+            break;
+        }
+        ctrler()->delay_profile().add_sample(action, latency_ms);
+        Log.trace(__FUNCTION__, action, "latency", latency_ms, "ms");
+        break;
+    }
+    // 等满了画面也没变，可能这个操作本来就不改变画面，不记录
+    return static_cast<int>(duration_cast<milliseconds>(steady_clock::now() - start_time).count());
+}
+
+asst::Rect asst::ProcessTask::sample_roi(const Rect& action_rect) const
+{
+    // 只看动作作用的区域附近和任务的识别区域，别处的动画、计时之类的变化和这次操作无关
+    constexpr int Margin = 50;
+    if (action_rect.empty()) {
+        return Rect();
+    }
+    cv::Rect roi = make_rect<cv::Rect>(action_rect);
+    roi -= cv::Point(Margin, Margin);
+    roi += cv::Size(Margin * 2, Margin * 2);
+    if (!m_cur_task_ptr->roi.empty()) {
+        roi |= make_rect<cv::Rect>(m_cur_task_ptr->roi);
+    }
+    return make_rect<Rect>(roi);
+}
+
+asst::Rect asst::ProcessTask::union_roi(const std::vector<std::string>& tasks_name)
+{
+    cv::Rect result;
+    for (const std::string& name : tasks_name) {
+        auto task_ptr = Task.get(name);
+        if (!task_ptr || task_ptr->algorithm == AlgorithmType::JustReturn) {
+            continue;
+        }
+        if (task_ptr->roi.empty()) {
+            return Rect();
+        }
+        result |= make_rect<cv::Rect>(task_ptr->roi);
+    }
+    return make_rect<Rect>(result);
+}
+
 std::pair<int, asst::ProcessTask::TimesLimitType> asst::ProcessTask::calc_time_limit() const
 {
     // eg. "C@B@A" 的 max_times 取 "C@B@A", "B@A", "A" 中有 max_times 定义的最靠前者
@@ -3,6 +3,7 @@
 #include "AbstractTask.h"
 #include "Common/AsstTypes.h"
 #include "Utils/NoWarningCVMat.h"
+#include "Vision/FrameChangeDetector.h"
 
 namespace asst
 {
@@ -38,6 +39,7 @@ namespace asst
         ProcessTask& set_reusable_image(const cv::Mat& reusable);
 
         const std::string& get_last_task_name() const noexcept { return m_last_task_name; }
+        virtual std::vector<std::string> get_entry_tasks() const override { return m_raw_task_name_list; }
 
     protected:
         virtual bool _run() override;
@@ -46,6 +48,20 @@ namespace asst
 
         std::pair<int, TimesLimitType> calc_time_limit() const;
         int calc_post_delay() const;
+        // 未开启自适应延时时等同于 sleep(max_delay)
+        // 开启时轮询截图，画面稳定下来（require_change 时还要求画面与动作前相比有过变化），
+        // 或 next_tasks 中已经有任务能识别到时提前返回，此时最后一帧会留给下一轮识别复用；最多等 max_delay
+        bool wait_until_stable(int max_delay, const std::vector<std::string>& next_tasks = {},
+                               bool require_change = true);
+        // 只有点击、滑动这类预期画面会有反应的操作才测延迟
+        static bool is_sampleable(ProcessTaskAction action) noexcept;
+        // 轮询截图直到 roi 内的画面与动作前紧挨着截的 ref_frame 相比有变化，把操作到变化的耗时记进设备的延迟档案；
+        // 比截图间隔还短的不记录。最多等 max_wait，返回实际等了多久
+        int sample_action_latency(const std::string& action, const cv::Mat& ref_frame, const Rect& roi, int max_wait);
+        // 测延迟时看哪里的变化：动作作用区域的附近，加上任务的识别区域；动作作用于全屏时返回空 Rect（即全屏）
+        Rect sample_roi(const Rect& action_rect) const;
+        // 所有任务 roi 的并集，有任一任务是全屏识别时返回空 Rect（即全屏）
+        static Rect union_roi(const std::vector<std::string>& tasks_name);
 
         void exec_click_task(const Rect& matched_rect);
         void exec_swipe_task(const Rect& r1, const Rect& r2, int duration, bool extra_swipe, double slope_in,
@@ -62,5 +78,10 @@ namespace asst
         static constexpr int TaskDelayUnsetted = -1;
         int m_task_delay = TaskDelayUnsetted;
         cv::Mat m_reusable;
+        cv::Mat m_action_frame; // 本轮识别用的画面，即执行动作前的画面
+
+        // 上次识别失败时的任务列表，以及对应区域的画面。重试时画面没变，识别结果一定也不会变
+        std::vector<std::string> m_unmatched_tasks;
+        FrameChangeDetector m_unmatched_frame;
     };
 }
@@ -174,7 +174,8 @@ bool asst::RoguelikeRecruitTaskPlugin::_run()
         if (need_exit()) {
             return false;
         }
-        image = ctrler()->get_image();
+        // 第一页可以直接复用上面识别临时招募时的截图
+        image = ctrler()->get_image_after_action();
         RoguelikeRecruitImageAnalyzer analyzer(image);
         if (!analyzer.analyze()) {
             Log.trace(__FUNCTION__, "| Page", i, "recruit list analyse failed");
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <algorithm>
+#include <limits>
+#include <optional>
+#include <queue>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace asst::utils
+{
+    // 多模式串匹配，按字节建自动机，对 UTF-8 的效果与 std::string::find 一致
+    // 一次扫描即可得到文本中出现的所有模式串，复杂度与文本长度成线性
+    class AhoCorasick
+    {
+    public:
+        static constexpr size_t npos = std::numeric_limits<size_t>::max();
+
+        AhoCorasick() = default;
+        explicit AhoCorasick(const std::vector<std::string>& patterns)
+        {
+            m_nodes.emplace_back();
+            for (size_t id = 0; id != patterns.size(); ++id) {
+                int cur = 0;
+                for (unsigned char c : patterns[id]) {
+                    int next = child(cur, c);
+                    if (next < 0) {
+                        next = static_cast<int>(m_nodes.size());
+                        auto& children = m_nodes[cur].children;
+                        children.emplace(std::upper_bound(children.begin(), children.end(), std::make_pair(c, next)),
+                                         c, next);
+                        m_nodes.emplace_back();
+                    }
+                    cur = next;
+                }
+                m_nodes[cur].min_id = std::min(m_nodes[cur].min_id, id);
+            }
+            build_fail();
+        }
+
+        bool empty() const noexcept { return m_nodes.empty(); }
+
+        // 返回在 text 中出现过的模式串里，下标最小的那个；都没出现则返回 std::nullopt
+        std::optional<size_t> first_pattern_in(std::string_view text) const
+        {
+            if (m_nodes.empty()) {
+                return std::nullopt;
+            }
+            size_t best = m_nodes.front().min_id;
+            int cur = 0;
+            for (unsigned char c : text) {
+                cur = go(cur, c);
+                best = std::min(best, m_nodes[cur].min_id);
+            }
+            if (best == npos) {
+                return std::nullopt;
+            }
+            return best;
+        }
+
+    private:
+        struct Node
+        {
+            std::vector<std::pair<unsigned char, int>> children; // 按字节有序
+            int fail = 0;
+            size_t min_id = npos; // 以此结点结尾的（含 fail 链上的）模式串中最小的下标
+        };
+
+        int child(int node, unsigned char c) const
+        {
+            const auto& children = m_nodes[node].children;
+            auto iter = std::lower_bound(children.begin(), children.end(), c,
+                                         [](const auto& pair, unsigned char value) { return pair.first < value; });
+            return (iter != children.end() && iter->first == c) ? iter->second : -1;
+        }
+
+        int go(int node, unsigned char c) const
+        {
+            while (true) {
+                if (int next = child(node, c); next >= 0) {
+                    return next;
+                }
+                if (node == 0) {
+                    return 0;
+                }
+                node = m_nodes[node].fail;
+            }
+        }
+
+        void build_fail()
+        {
+            std::queue<int> bfs;
+            for (const auto& [c, next] : m_nodes.front().children) {
+                m_nodes[next].fail = 0;
+                m_nodes[next].min_id = std::min(m_nodes[next].min_id, m_nodes.front().min_id);
+                bfs.emplace(next);
+            }
+            while (!bfs.empty()) {
+                int cur = bfs.front();
+                bfs.pop();
+                for (const auto& [c, next] : m_nodes[cur].children) {
+                    int fail = go(m_nodes[cur].fail, c);
+                    m_nodes[next].fail = fail;
+                    m_nodes[next].min_id = std::min(m_nodes[next].min_id, m_nodes[fail].min_id);
+                    bfs.emplace(next);
+                }
+            }
+        }
+
+        std::vector<Node> m_nodes;
+    };
+}
@@ -0,0 +1,142 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+#include "SingletonHolder.hpp"
+
+namespace asst
+{
+    // 进程内共用的工作线程池，识别时的并行都从这里借线程，避免每次识别都新建、销毁线程
+    class WorkerPool final : public SingletonHolder<WorkerPool>
+    {
+    public:
+        // 一批下标为 0 ~ count-1 的工作，按下标顺序领取。调用方和池里的线程一起做：
+        // 调用方不会去等还没开始的池线程，所以在池线程里再开一批也不会因为线程都在等待而死锁
+        class Batch
+        {
+        public:
+            Batch(size_t count, std::function<void(size_t)> func) : m_count(count), m_func(std::move(func)) {}
+
+            // 领取下一项并执行，已经没有可领的了返回 false
+            bool run_next()
+            {
+                const size_t index = m_next++;
+                if (index >= m_count) {
+                    return false;
+                }
+                try {
+                    m_func(index);
+                }
+                catch (...) {
+                    std::unique_lock<std::mutex> lock(m_mutex);
+                    if (!m_exception) {
+                        m_exception = std::current_exception();
+                    }
+                }
+                if (++m_done == m_count) {
+                    std::unique_lock<std::mutex> lock(m_mutex);
+                    m_condvar.notify_all();
+                }
+                return true;
+            }
+
+            // 调用方把剩下的都做完，再等别的线程手上的做完；有异常时抛出第一个
+            // 返回之后 func 不会再被调用，func 可以放心引用调用方栈上的变量
+            void wait()
+            {
+                while (run_next()) {
+                }
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_condvar.wait(lock, [&]() { return m_done >= m_count; });
+                if (m_exception) {
+                    std::rethrow_exception(m_exception);
+                }
+            }
+
+        private:
+            const size_t m_count;
+            const std::function<void(size_t)> m_func;
+            std::atomic_size_t m_next = 0;
+            std::atomic_size_t m_done = 0;
+            std::mutex m_mutex;
+            std::condition_variable m_condvar;
+            std::exception_ptr m_exception;
+        };
+
+        virtual ~WorkerPool() override
+        {
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_exit = true;
+            }
+            m_condvar.notify_all();
+            for (auto& thread : m_threads) {
+                thread.join();
+            }
+        }
+
+        // 创建一批工作，最多请 helpers 个池线程帮忙；调用方之后需要调用 wait()
+        std::shared_ptr<Batch> parallel(size_t count, size_t helpers, std::function<void(size_t)> func)
+        {
+            auto batch = std::make_shared<Batch>(count, std::move(func));
+            helpers = std::min({ helpers, count, m_threads.size() });
+            if (helpers == 0) {
+                return batch;
+            }
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                for (size_t i = 0; i < helpers; ++i) {
+                    m_jobs.emplace([batch]() {
+                        while (batch->run_next()) {
+                        }
+                    });
+                }
+            }
+            m_condvar.notify_all();
+            return batch;
+        }
+
+    private:
+        friend class SingletonHolder<WorkerPool>;
+
+        WorkerPool()
+        {
+            const size_t threads_size = std::max(std::thread::hardware_concurrency(), 2U);
+            for (size_t i = 0; i < threads_size; ++i) {
+                m_threads.emplace_back(&WorkerPool::work_proc, this);
+            }
+        }
+
+        void work_proc()
+        {
+            while (true) {
+                std::function<void()> job;
+                {
+                    std::unique_lock<std::mutex> lock(m_mutex);
+                    m_condvar.wait(lock, [&]() { return m_exit || !m_jobs.empty(); });
+                    if (m_exit) {
+                        return;
+                    }
+                    job = std::move(m_jobs.front());
+                    m_jobs.pop();
+                }
+                job();
+            }
+        }
+
+        std::vector<std::thread> m_threads;
+        std::queue<std::function<void()>> m_jobs;
+        std::mutex m_mutex;
+        std::condition_variable m_condvar;
+        bool m_exit = false;
+    };
+}
@@ -38,54 +38,83 @@ BattlefieldClassifier::ResultOpt BattlefieldClassifier::analyze() const
 
 BattlefieldClassifier::SkillReadyResult BattlefieldClassifier::skill_ready_analyze() const
 {
-    auto task_ptr = Task.get<MatchTaskInfo>("BattleSkillReady");
-    const Rect& skill_roi_move = task_ptr->rect_move;
-    Rect roi = Rect(m_base_point.x, m_base_point.y, 0, 0).move(skill_roi_move);
-
-    cv::Mat image = make_roi(m_image, correct_rect(roi, m_image));
-    std::vector<float> input = image_to_tensor(image);
+    return batch_skill_ready_analyze({ m_base_point }).front();
+}
 
-    auto memory_info = Ort::MemoryInfo::CreateCpu(OrtDeviceAllocator, OrtMemTypeCPU);
-    constexpr int64_t batch_size = 1;
-    std::array<int64_t, 4> input_shape { batch_size, image.channels(), image.cols, image.rows };
+std::vector<BattlefieldClassifier::SkillReadyResult>
+    BattlefieldClassifier::batch_skill_ready_analyze(const std::vector<Point>& base_points) const
+{
+    if (base_points.empty()) {
+        return {};
+    }
 
-    Ort::Value input_tensor = Ort::Value::CreateTensor<float>(memory_info, input.data(), input.size(),
-                                                              input_shape.data(), input_shape.size());
-    SkillReadyResult::Raw raw_results;
-    std::array<int64_t, 2> output_shape { batch_size, SkillReadyResult::ClsSize };
-    Ort::Value output_tensor = Ort::Value::CreateTensor<float>(memory_info, raw_results.data(), raw_results.size(),
-                                                               output_shape.data(), output_shape.size());
+    auto task_ptr = Task.get<MatchTaskInfo>("BattleSkillReady");
+    const Rect& skill_roi_move = task_ptr->rect_move;
 
-    auto& session = OnnxSessions::get_instance().get("skill_ready_cls");
-    // 这俩是hardcode在模型里的
-    constexpr const char* input_names[] = { "input" };   // session.GetInputName()
-    constexpr const char* output_names[] = { "output" }; // session.GetOutputName()
+    auto context = OnnxSessions::get_instance().get_context("skill_ready_cls");
+    // [batch, channels, cols, rows]
+    const auto& model_shape = context->input_shape();
+    const cv::Size model_size(static_cast<int>(model_shape[2]), static_cast<int>(model_shape[3]));
+
+    const size_t total = base_points.size();
+    // 目前的模型导出时 batch 固定为 1，只能分批跑；换成动态 batch 的模型后就是一次推理
+    const size_t batch_limit = static_cast<size_t>(std::min(context->max_batch(), static_cast<int64_t>(total)));
+
+    std::vector<Rect> rois;
+    rois.reserve(total);
+    std::vector<SkillReadyResult::Raw> raw_results(total);
+    for (size_t offset = 0; offset < total; offset += batch_limit) {
+        const size_t batch_size = std::min(batch_limit, total - offset);
+        float* input = context->input_buffer(static_cast<int64_t>(batch_size));
+        for (size_t i = 0; i < batch_size; ++i) {
+            const Point& base_point = base_points[offset + i];
+            Rect roi = Rect(base_point.x, base_point.y, 0, 0).move(skill_roi_move);
+            cv::Mat image = make_roi(m_image, correct_rect(roi, m_image));
+            // 贴着屏幕边缘的会被裁小，拼成一批时尺寸必须一致
+            if (image.size() != model_size) {
+                cv::resize(image, image, model_size);
+            }
+            image_to_tensor(image, input + i * context->input_sample_size());
+            rois.emplace_back(roi);
+        }
+
+        const float* output = context->run();
+        for (size_t i = 0; i < batch_size; ++i) {
+            std::copy_n(output + i * SkillReadyResult::ClsSize, SkillReadyResult::ClsSize,
+                        raw_results[offset + i].begin());
+        }
+    }
 
-    Ort::RunOptions run_options;
-    session.Run(run_options, input_names, &input_tensor, 1, output_names, &output_tensor, 1);
-    Log.info(__FUNCTION__, "raw results:", raw_results);
+    std::vector<SkillReadyResult> results;
+    results.reserve(total);
+    for (size_t i = 0; i < total; ++i) {
+        const auto& raw = raw_results[i];
+        const Rect& roi = rois[i];
+        Log.info(__FUNCTION__, base_points[i], "raw results:", raw);
 
-    SkillReadyResult::Prob prob = softmax(raw_results);
-    Log.info(__FUNCTION__, "prob:", prob);
-    bool ready = prob[1] > prob[0];
-    float score = std::max(prob[0], prob[1]);
+        SkillReadyResult::Prob prob = softmax(raw);
+        Log.info(__FUNCTION__, base_points[i], "prob:", prob);
+        bool ready = prob[1] > prob[0];
+        float score = std::max(prob[0], prob[1]);
 
 #ifdef ASST_DEBUG
-    if (ready) {
-        cv::rectangle(m_image_draw, make_rect<cv::Rect>(roi), cv::Scalar(0, 165, 255), 2);
-        cv::putText(m_image_draw, std::to_string(score), cv::Point(roi.x, roi.y - 10), 1, 1.2, cv::Scalar(0, 165, 255),
-                    2);
-    }
+        if (ready) {
+            cv::rectangle(m_image_draw, make_rect<cv::Rect>(roi), cv::Scalar(0, 165, 255), 2);
+            cv::putText(m_image_draw, std::to_string(score), cv::Point(roi.x, roi.y - 10), 1, 1.2,
+                        cv::Scalar(0, 165, 255), 2);
+        }
 #endif
 
-    return SkillReadyResult {
-        .ready = ready,
-        .rect = roi,
-        .score = score,
-        .raw = raw_results,
-        .prob = prob,
-        .base_point = m_base_point,
-    };
+        results.emplace_back(SkillReadyResult {
+            .ready = ready,
+            .rect = roi,
+            .score = score,
+            .raw = raw,
+            .prob = prob,
+            .base_point = base_points[i],
+        });
+    }
+    return results;
 }
 
 BattlefieldClassifier::DeployDirectionResult BattlefieldClassifier::deploy_direction_analyze() const
@@ -94,28 +123,20 @@ BattlefieldClassifier::DeployDirectionResult BattlefieldClassifier::deploy_direc
     const Rect& roi_move = task_ptr->rect_move;
     Rect roi = Rect(m_base_point.x, m_base_point.y, 0, 0).move(roi_move);
 
-    cv::Mat image = make_roi(m_image, correct_rect(roi, m_image));
-    std::vector<float> input = image_to_tensor(image);
+    auto context = OnnxSessions::get_instance().get_context("deploy_direction_cls");
+    // [batch, channels, cols, rows]
+    const auto& model_shape = context->input_shape();
+    const cv::Size model_size(static_cast<int>(model_shape[2]), static_cast<int>(model_shape[3]));
 
-    auto memory_info = Ort::MemoryInfo::CreateCpu(OrtDeviceAllocator, OrtMemTypeCPU);
-    constexpr int64_t batch_size = 1;
-    std::array<int64_t, 4> input_shape { batch_size, image.channels(), image.cols, image.rows };
-
-    Ort::Value input_tensor = Ort::Value::CreateTensor<float>(memory_info, input.data(), input.size(),
-                                                              input_shape.data(), input_shape.size());
+    cv::Mat image = make_roi(m_image, correct_rect(roi, m_image));
+    if (image.size() != model_size) {
+        cv::resize(image, image, model_size);
+    }
+    image_to_tensor(image, context->input_buffer());
+    const float* output = context->run();
 
     DeployDirectionResult::Raw raw_results;
-    std::array<int64_t, 2> output_shape { batch_size, DeployDirectionResult::ClsSize };
-    Ort::Value output_tensor = Ort::Value::CreateTensor<float>(memory_info, raw_results.data(), raw_results.size(),
-                                                               output_shape.data(), output_shape.size());
-
-    auto& session = OnnxSessions::get_instance().get("deploy_direction_cls");
-    // 这俩是hardcode在模型里的
-    constexpr const char* input_names[] = { "input" };   // session.GetInputName()
-    constexpr const char* output_names[] = { "output" }; // session.GetOutputName()
-
-    Ort::RunOptions run_options;
-    session.Run(run_options, input_names, &input_tensor, 1, output_names, &output_tensor, 1);
+    std::copy_n(output, DeployDirectionResult::ClsSize, raw_results.begin());
     Log.info(__FUNCTION__, "raw result:", raw_results);
 
     DeployDirectionResult::Prob prob = softmax(raw_results);
@@ -65,6 +65,9 @@ namespace asst
 
         ResultOpt analyze() const;
 
+        // 一次推理识别多个位置的技能是否就绪，结果与 base_points 一一对应
+        std::vector<SkillReadyResult> batch_skill_ready_analyze(const std::vector<Point>& base_points) const;
+
     protected:
         SkillReadyResult skill_ready_analyze() const;
         DeployDirectionResult deploy_direction_analyze() const;
@@ -38,32 +38,17 @@ std::vector<BattlefieldDetector::OperatorResult> BattlefieldDetector::operator_a
     const double x_scale = 640.0 / m_image.cols;
     const double y_scale = 640.0 / m_image.rows;
 
-    cv::Mat image;
-    cv::resize(m_image, image, cv::Size(), x_scale, y_scale, cv::INTER_AREA);
-    std::vector<float> input = image_to_tensor(image);
-
-    auto memory_info = Ort::MemoryInfo::CreateCpu(OrtDeviceAllocator, OrtMemTypeCPU);
-    constexpr int64_t batch_size = 1;
-    std::array<int64_t, 4> input_shape { batch_size, image.channels(), image.cols, image.rows };
-
-    Ort::Value input_tensor = Ort::Value::CreateTensor<float>(memory_info, input.data(), input.size(),
-                                                              input_shape.data(), input_shape.size());
-
-    auto& session = OnnxSessions::get_instance().get("operators_det");
+    auto context = OnnxSessions::get_instance().get_context("operators_det");
 
-    Ort::AllocatorWithDefaultOptions allocator;
-    std::string input_name = session.GetInputNameAllocated(0, allocator).get();
-    std::string output_name = session.GetOutputNameAllocated(0, allocator).get();
-    std::vector input_names = { input_name.c_str() };
-    std::vector output_names = { output_name.c_str() };
-
-    Ort::RunOptions run_options;
-    auto output_tensors = session.Run(run_options, input_names.data(), &input_tensor, input_names.size(),
-                                      output_names.data(), output_names.size());
+    // 缩放后的图只是个中间结果，复用同一块内存
+    static thread_local cv::Mat image;
+    cv::resize(m_image, image, cv::Size(), x_scale, y_scale, cv::INTER_AREA);
+    image_to_tensor(image, context->input_buffer());
 
-    const float* raw_output = output_tensors[0].GetTensorData<float>();
+    const float* raw_output = context->run();
     // output_shape is { 1, 5, 8400 }
-    std::vector<int64_t> output_shape = output_tensors[0].GetTensorTypeAndShapeInfo().GetShape();
+    const auto& output_shape = context->output_shape();
+    const int64_t boxes_count = output_shape[2];
 
     // yolov8 的 onnx 输出和前面的 v5, v7 等似乎不太一样，目前网上 yolov8 的 demo 较少，文档也没找到
     // 这里的输出解析是我跟着数据推测的：
@@ -73,10 +58,7 @@ std::vector<BattlefieldDetector::OperatorResult> BattlefieldDetector::operator_a
     // h0, h1, ..... h8399
     // conf0, conf1, ..... conf8399
     // 如果后面要做多分类，可能得再看下怎么改（我也不知道shape会变成啥样）
-    std::vector<std::vector<float>> output(output_shape[1]);
-    for (int64_t i = 0; i < output_shape[1]; i++) {
-        output[i] = std::vector<float>(raw_output + i * output_shape[2], raw_output + (i + 1) * output_shape[2]);
-    }
+    auto output_row = [&](int64_t row) { return raw_output + row * boxes_count; };
 
 #ifdef ASST_DEBUG
 
@@ -86,18 +68,18 @@ std::vector<BattlefieldDetector::OperatorResult> BattlefieldDetector::operator_a
 #endif
 
     std::vector<OperatorResult> all_results;
-    const auto& conf_vec = output.back();
-    for (size_t i = 0; i < conf_vec.size(); ++i) {
+    const float* conf_vec = output_row(output_shape[1] - 1);
+    for (int64_t i = 0; i < boxes_count; ++i) {
         float score = conf_vec[i];
         constexpr float Threshold = 0.3f;
         if (score < Threshold) {
             continue;
         }
 
-        int center_x = static_cast<int>(output[0][i] / x_scale);
-        int center_y = static_cast<int>(output[1][i] / y_scale);
-        int w = static_cast<int>(output[2][i] / x_scale);
-        int h = static_cast<int>(output[3][i] / y_scale);
+        int center_x = static_cast<int>(output_row(0)[i] / x_scale);
+        int center_y = static_cast<int>(output_row(1)[i] / y_scale);
+        int w = static_cast<int>(output_row(2)[i] / x_scale);
+        int h = static_cast<int>(output_row(3)[i] / y_scale);
 
         int x = center_x - w / 2;
         int y = center_y - h / 2;
@@ -2,12 +2,14 @@
 
 #include "Utils/Ranges.hpp"
 #include <algorithm>
+#include <functional>
 
 #include "Utils/NoWarningCV.h"
 
 #include "Config/TaskData.h"
 #include "Config/TemplResource.h"
 #include "Utils/Logger.hpp"
+#include "Utils/WorkerPool.hpp"
 #include "Vision/BestMatcher.h"
 #include "Vision/Matcher.h"
 #include "Vision/MultiMatcher.h"
@@ -16,6 +18,15 @@
 
 using namespace asst;
 
+namespace
+{
+    const std::unordered_map<std::string, battle::Role> RoleMap = {
+        { "Caster", battle::Role::Caster }, { "Medic", battle::Role::Medic },     { "Pioneer", battle::Role::Pioneer },
+        { "Sniper", battle::Role::Sniper }, { "Special", battle::Role::Special }, { "Support", battle::Role::Support },
+        { "Tank", battle::Role::Tank },     { "Warrior", battle::Role::Warrior }, { "Drone", battle::Role::Drone },
+    };
+}
+
 void BattlefieldMatcher::set_object_of_interest(ObjectOfInterest obj)
 {
     m_object_of_interest = std::move(obj);
@@ -38,33 +49,48 @@ BattlefieldMatcher::ResultOpt BattlefieldMatcher::analyze() const
         }
     }
 
-    if (m_object_of_interest.deployment) {
-        result.deployment = deployment_analyze();
-    }
-
-    if (m_object_of_interest.kills) {
-        result.kills = kills_analyze();
-        if (!result.kills) {
-            return std::nullopt;
-        }
-    }
-
-    if (m_object_of_interest.costs) {
-        result.costs = costs_analyze();
-        if (!result.costs) {
-            return std::nullopt;
-        }
-    }
-
     // 识别的不准，暂时不用了
     // if (m_object_of_interest.in_detail) {
     //    result.in_detail = in_detail_analyze();
     //}
 
+    // 很快就能识别完，而且会往 m_image_draw 上画图，在分出工作之前先做
     if (m_object_of_interest.speed_button) {
         result.speed_button = speed_button_analyze();
     }
 
+    // 以下各项互不依赖，可以分到工作线程里同时识别
+    // OCR 的模型不能并发推理，所以击杀数和费用放在同一项里先后识别
+    std::vector<std::function<void()>> procs;
+    if (m_object_of_interest.deployment) {
+        procs.emplace_back([&]() { result.deployment = deployment_analyze(); });
+    }
+
+    if (m_object_of_interest.kills || m_object_of_interest.costs) {
+        procs.emplace_back([&]() {
+            if (m_object_of_interest.kills) {
+                result.kills = kills_analyze();
+                if (!result.kills) {
+                    return;
+                }
+            }
+            if (m_object_of_interest.costs) {
+                result.costs = costs_analyze();
+            }
+        });
+    }
+
+    // 当前线程也干活，所以只需要再借 m_threads - 1 个
+    const size_t helpers = static_cast<size_t>(std::max(m_threads, 1)) - 1;
+    WorkerPool::get_instance().parallel(procs.size(), helpers, [&](size_t i) { procs[i](); })->wait();
+
+    if (m_object_of_interest.kills && !result.kills) {
+        return std::nullopt;
+    }
+    if (m_object_of_interest.costs && !result.costs) {
+        return std::nullopt;
+    }
+
     return result;
 }
 
@@ -91,9 +117,14 @@ std::vector<battle::DeploymentOper> BattlefieldMatcher::deployment_analyze() con
     const Rect& cooling_move = Task.get("BattleOperCooling")->rect_move;
     const Rect& avatar_move = Task.get("BattleOperAvatar")->rect_move;
 
-    std::vector<battle::DeploymentOper> oper_result;
-    size_t index = 0;
-    for (const auto& flag_res : flags) {
+    // 每张卡片的识别互不相干，按卡片分给多个线程；识别不出职业的卡片留空，最后再按顺序编号
+    std::vector<std::optional<battle::DeploymentOper>> opers(flags.size());
+#ifdef ASST_DEBUG
+    // 往 m_image_draw 上画图不是线程安全的，各卡片先记下位置，都识别完了再统一画
+    std::vector<Rect> role_rects(flags.size());
+#endif
+    auto analyze_card = [&](size_t i) {
+        const auto& flag_res = flags[i];
         battle::DeploymentOper oper;
         oper.rect = flag_res.rect.move(click_move);
 
@@ -101,8 +132,11 @@ std::vector<battle::DeploymentOper> BattlefieldMatcher::deployment_analyze() con
         oper.role = oper_role_analyze(role_rect);
         if (oper.role == battle::Role::Unknown) {
             Log.warn("Unknown role");
-            continue;
+            return;
         }
+#ifdef ASST_DEBUG
+        role_rects[i] = role_rect;
+#endif
 
         if (oper.rect.x + oper.rect.width >= m_image.cols) {
             oper.rect.width = m_image.cols - oper.rect.x;
@@ -113,24 +147,37 @@ std::vector<battle::DeploymentOper> BattlefieldMatcher::deployment_analyze() con
         Rect available_rect = flag_res.rect.move(avlb_move);
         oper.available = oper_available_analyze(available_rect);
 
-#ifdef ASST_DEBUG
-        if (oper.available) {
-            cv::rectangle(m_image_draw, make_rect<cv::Rect>(oper.rect), cv::Scalar(0, 255, 0), 2);
-        }
-        else {
-            cv::rectangle(m_image_draw, make_rect<cv::Rect>(oper.rect), cv::Scalar(0, 0, 255), 2);
-        }
-#endif
-
         Rect cooling_rect = correct_rect(flag_res.rect.move(cooling_move), m_image);
         oper.cooling = oper_cooling_analyze(cooling_rect);
         if (oper.cooling && oper.available) {
             Log.error("oper is available, but with cooling");
         }
 
-        oper.index = index++;
+        opers[i] = std::move(oper);
+    };
+
+    // 当前线程也干活，所以只需要再借 m_threads - 1 个
+    const size_t helpers = static_cast<size_t>(std::max(m_threads, 1)) - 1;
+    WorkerPool::get_instance().parallel(flags.size(), helpers, analyze_card)->wait();
 
-        oper_result.emplace_back(std::move(oper));
+    std::vector<battle::DeploymentOper> oper_result;
+    size_t index = 0;
+    for (size_t i = 0; i < opers.size(); ++i) {
+        auto& oper = opers[i];
+        if (!oper) {
+            continue;
+        }
+#ifdef ASST_DEBUG
+        cv::rectangle(m_image_draw, make_rect<cv::Rect>(oper->rect),
+                      oper->available ? cv::Scalar(0, 255, 0) : cv::Scalar(0, 0, 255), 2);
+        auto role_iter = ranges::find_if(RoleMap, [&](const auto& pair) { return pair.second == oper->role; });
+        if (role_iter != RoleMap.end()) {
+            cv::putText(m_image_draw, role_iter->first, cv::Point(role_rects[i].x, role_rects[i].y - 5), 1, 1,
+                        cv::Scalar(0, 255, 255));
+        }
+#endif
+        oper->index = index++;
+        oper_result.emplace_back(std::move(*oper));
     }
 
     return oper_result;
@@ -138,12 +185,6 @@ std::vector<battle::DeploymentOper> BattlefieldMatcher::deployment_analyze() con
 
 battle::Role BattlefieldMatcher::oper_role_analyze(const Rect& roi) const
 {
-    static const std::unordered_map<std::string, battle::Role> RoleMap = {
-        { "Caster", battle::Role::Caster }, { "Medic", battle::Role::Medic },     { "Pioneer", battle::Role::Pioneer },
-        { "Sniper", battle::Role::Sniper }, { "Special", battle::Role::Special }, { "Support", battle::Role::Support },
-        { "Tank", battle::Role::Tank },     { "Warrior", battle::Role::Warrior }, { "Drone", battle::Role::Drone },
-    };
-
     static const std::string TaskName = "BattleOperRole";
     static const std::string Ext = ".png";
     BestMatcher role_analyzer(m_image);
@@ -165,11 +206,6 @@ battle::Role BattlefieldMatcher::oper_role_analyze(const Rect& roi) const
     const auto& templ_name = role_opt->templ_info.name;
 
     std::string role_name = templ_name.substr(TaskName.size(), templ_name.size() - TaskName.size() - Ext.size());
-
-#ifdef ASST_DEBUG
-    cv::putText(m_image_draw, role_name, cv::Point(roi.x, roi.y - 5), 1, 1, cv::Scalar(0, 255, 255));
-#endif
-
     return RoleMap.at(role_name);
 }
 
@@ -178,8 +214,7 @@ bool BattlefieldMatcher::oper_cooling_analyze(const Rect& roi) const
     const auto cooling_task_ptr = Task.get<MatchTaskInfo>("BattleOperCooling");
 
     auto img_roi = m_image(make_rect<cv::Rect>(roi));
-    cv::Mat hsv;
-    cv::cvtColor(img_roi, hsv, cv::COLOR_BGR2HSV);
+    cv::Mat hsv = hsv_of(img_roi);
     int h_low = cooling_task_ptr->mask_range.first;
     int h_up = cooling_task_ptr->mask_range.second;
     int s_low = cooling_task_ptr->specific_rect.x;
@@ -211,8 +246,7 @@ int BattlefieldMatcher::oper_cost_analyze(const Rect& roi) const
 
 bool BattlefieldMatcher::oper_available_analyze(const Rect& roi) const
 {
-    cv::Mat hsv;
-    cv::cvtColor(m_image(make_rect<cv::Rect>(roi)), hsv, cv::COLOR_BGR2HSV);
+    cv::Mat hsv = hsv_of(m_image(make_rect<cv::Rect>(roi)));
     cv::Scalar avg = cv::mean(hsv);
     // Log.trace("oper available, mean", avg[2]);
 
@@ -325,8 +359,7 @@ bool BattlefieldMatcher::pause_button_analyze() const
 {
     auto task_ptr = Task.get("BattleHasStarted");
     cv::Mat roi = m_image(make_rect<cv::Rect>(task_ptr->roi));
-    cv::Mat roi_gray;
-    cv::cvtColor(roi, roi_gray, cv::COLOR_BGR2GRAY);
+    cv::Mat roi_gray = gray_of(roi);
     cv::Mat bin;
     const int value_threshold = task_ptr->special_params[0];
     cv::threshold(roi_gray, bin, value_threshold, 255, cv::THRESH_BINARY);
@@ -349,8 +382,7 @@ bool BattlefieldMatcher::in_detail_analyze() const
     auto analyze = [&](const std::string& task_name) {
         auto task_ptr = Task.get(task_name);
         cv::Mat roi = m_image(make_rect<cv::Rect>(task_ptr->roi));
-        cv::Mat roi_hsv;
-        cv::cvtColor(roi, roi_hsv, cv::COLOR_BGR2HSV);
+        cv::Mat roi_hsv = hsv_of(roi);
         cv::Mat bin1;
         cv::inRange(roi_hsv, cv::Scalar(99, 235, 235), cv::Scalar(105, 255, 255), bin1);
         int count1 = cv::countNonZero(bin1);
@@ -375,8 +407,7 @@ bool asst::BattlefieldMatcher::speed_button_analyze() const
 {
     auto task_ptr = Task.get("BattleSpeedButton");
     cv::Mat roi = m_image(make_rect<cv::Rect>(task_ptr->roi));
-    cv::Mat roi_gray;
-    cv::cvtColor(roi, roi_gray, cv::COLOR_BGR2GRAY);
+    cv::Mat roi_gray = gray_of(roi);
     cv::Mat bin;
     const int value_threshold = task_ptr->special_params[0];
     cv::threshold(roi_gray, bin, value_threshold, 255, cv::THRESH_BINARY);
@@ -40,6 +40,8 @@ namespace asst
 
         void set_object_of_interest(ObjectOfInterest obj);
         void set_total_kills_prompt(int prompt);
+        // 大于 1 时，互不依赖的各项识别、以及每个干员卡片的识别会借用 WorkerPool 的线程同时做
+        void set_threads(int threads) noexcept { m_threads = threads; }
 
         ResultOpt analyze() const;
 
@@ -61,5 +63,6 @@ namespace asst
 
         ObjectOfInterest m_object_of_interest; // 待识别的目标
         int m_total_kills_prompt = 0; // 之前的击杀总数，因为击杀数经常识别不准所以依赖外部传入作为参考
+        int m_threads = 1;
     };
 } // namespace asst
@@ -1,5 +1,8 @@
 #include "BestMatcher.h"
 
+#include <cfloat>
+#include <cstring>
+
 #include "Utils/NoWarningCV.h"
 
 #include "Config/TaskData.h"
@@ -17,32 +20,34 @@ void BestMatcher::append_templ(std::string name, const cv::Mat& templ)
 
 BestMatcher::ResultOpt BestMatcher::analyze() const
 {
-    Matcher match_analyzer(m_image, m_roi);
-    match_analyzer.set_params(m_params);
+    Result result;
+    if (!batch_analyze(result)) {
+        Matcher match_analyzer(m_image, m_roi);
+        match_analyzer.set_params(m_params);
 #ifdef ASST_DEBUG
-    match_analyzer.set_log_tracing(m_log_tracing);
+        match_analyzer.set_log_tracing(m_log_tracing);
 #else
-    match_analyzer.set_log_tracing(false);
+        match_analyzer.set_log_tracing(false);
 #endif
 
-    Result result;
-    for (const auto& templ_info : m_templs) {
-        auto&& [name, templ] = templ_info;
+        for (const auto& templ_info : m_templs) {
+            auto&& [name, templ] = templ_info;
 
-        if (templ.empty()) {
-            match_analyzer.set_templ(name);
-        }
-        else {
-            match_analyzer.set_templ(templ);
-        }
+            if (templ.empty()) {
+                match_analyzer.set_templ(name);
+            }
+            else {
+                match_analyzer.set_templ(templ);
+            }
 
-        const auto& cur_opt = match_analyzer.analyze();
-        if (!cur_opt) {
-            continue;
-        }
-        const auto& cur_matched = cur_opt.value();
-        if (result.score < cur_matched.score) {
-            result = Result { .rect = cur_matched.rect, .score = cur_matched.score, .templ_info = templ_info };
+            const auto& cur_opt = match_analyzer.analyze();
+            if (!cur_opt) {
+                continue;
+            }
+            const auto& cur_matched = cur_opt.value();
+            if (result.score < cur_matched.score) {
+                result = Result { .rect = cur_matched.rect, .score = cur_matched.score, .templ_info = templ_info };
+            }
         }
     }
 
@@ -56,3 +61,137 @@ BestMatcher::ResultOpt BestMatcher::analyze() const
     m_result = std::move(result);
     return m_result;
 }
+
+bool BestMatcher::batch_analyze(Result& result) const
+{
+    // 逐模板直接相关的计算量超过这个值时，OpenCV 会走 DFT，比矩阵乘法划算
+    constexpr size_t BatchMaxMacsPerTempl = 1 << 21;
+
+    const bool use_mask = m_params.mask_range.first != 0 || m_params.mask_range.second != 0;
+    if (!m_batch_match || m_templs.size() < 2 || use_mask || m_params.pyramid_levels > 0 ||
+        m_params.templ_thres.empty()) {
+        return false;
+    }
+
+    const cv::Mat image = make_roi(m_image, m_roi);
+    std::vector<cv::Mat> templs;
+    templs.reserve(m_templs.size());
+    for (const auto& [name, templ] : m_templs) {
+        templs.emplace_back(templ.empty() ? TemplResource::get_instance().get_templ(name) : templ);
+        const cv::Mat& cur = templs.back();
+        // 空模板、尺寸或类型不一致的交给逐个匹配去处理（和报错）
+        if (cur.empty() || cur.size() != templs.front().size() || cur.type() != image.type() ||
+            cur.depth() != CV_8U) {
+            return false;
+        }
+        // 纯色模板 OpenCV 在任何位置都给 1 分，矩阵乘法这边分母为 0 只能得 0，也交给逐个匹配
+        cv::Scalar templ_mean, templ_sdv;
+        cv::meanStdDev(cur, templ_mean, templ_sdv);
+        if (templ_sdv.dot(templ_sdv) < DBL_EPSILON) {
+            return false;
+        }
+    }
+
+    const cv::Size templ_size = templs.front().size();
+    if (templ_size.width > image.cols || templ_size.height > image.rows) {
+        return false;
+    }
+    const int out_cols = image.cols - templ_size.width + 1;
+    const int out_rows = image.rows - templ_size.height + 1;
+    const int positions = out_cols * out_rows;
+    const int cn = image.channels();
+    const int row_len = templ_size.width * cn;
+    const int dim = row_len * templ_size.height;
+    if (static_cast<size_t>(positions) * dim > BatchMaxMacsPerTempl) {
+        return false;
+    }
+
+    // TM_CCOEFF_NORMED: 分子是 去均值的模板 与 窗口 的相关（模板去均值后，窗口是否去均值不影响结果），
+    // 分母是 模板去均值后的模长 * 窗口去均值后的模长，均值都是按通道分别计算的
+    const int count = static_cast<int>(templs.size());
+    cv::Mat templ_mat(count, dim, CV_32F);
+    std::vector<double> templ_norms(count);
+    for (int k = 0; k < count; ++k) {
+        cv::Mat templ_f;
+        templs[k].convertTo(templ_f, CV_32F);
+        cv::subtract(templ_f, cv::mean(templ_f), templ_f);
+        templ_norms[k] = cv::norm(templ_f);
+        templ_f.reshape(1, 1).copyTo(templ_mat.row(k));
+    }
+
+    cv::Mat image_f;
+    image.convertTo(image_f, CV_32F);
+    cv::Mat patches(positions, dim, CV_32F);
+    for (int y = 0; y < out_rows; ++y) {
+        for (int x = 0; x < out_cols; ++x) {
+            float* dst = patches.ptr<float>(y * out_cols + x);
+            for (int r = 0; r < templ_size.height; ++r) {
+                std::memcpy(dst + r * row_len, image_f.ptr<float>(y + r) + x * cn, row_len * sizeof(float));
+            }
+        }
+    }
+
+    // positions x count，每一列是一个模板在所有位置上的分子
+    cv::Mat numerators;
+    cv::gemm(patches, templ_mat, 1.0, cv::noArray(), 0.0, numerators, cv::GEMM_2_T);
+
+    cv::Mat sum, sqsum;
+    cv::integral(image, sum, sqsum, CV_64F, CV_64F);
+    const double area = templ_size.area();
+    std::vector<double> wnd_norms(positions);
+    for (int y = 0; y < out_rows; ++y) {
+        const double* s_top = sum.ptr<double>(y);
+        const double* s_bottom = sum.ptr<double>(y + templ_size.height);
+        const double* q_top = sqsum.ptr<double>(y);
+        const double* q_bottom = sqsum.ptr<double>(y + templ_size.height);
+        for (int x = 0; x < out_cols; ++x) {
+            const int l = x * cn;
+            const int r = (x + templ_size.width) * cn;
+            double var = 0;
+            for (int c = 0; c < cn; ++c) {
+                double s = s_bottom[r + c] - s_top[r + c] - s_bottom[l + c] + s_top[l + c];
+                double q = q_bottom[r + c] - q_top[r + c] - q_bottom[l + c] + q_top[l + c];
+                var += q - s * s / area;
+            }
+            wnd_norms[y * out_cols + x] = std::sqrt(std::max(var, 0.0));
+        }
+    }
+
+    const double threshold = m_params.templ_thres.front();
+    for (int k = 0; k < count; ++k) {
+        double max_val = -1;
+        int max_pos = 0;
+        for (int p = 0; p < positions; ++p) {
+            // 与 OpenCV 对分母过小时的处理保持一致
+            double num = numerators.at<float>(p, k);
+            const double t = wnd_norms[p] * templ_norms[k];
+            if (std::fabs(num) < t) {
+                num /= t;
+            }
+            else if (std::fabs(num) < t * 1.125) {
+                num = num > 0 ? 1 : -1;
+            }
+            else {
+                num = 0;
+            }
+            if (num > max_val) {
+                max_val = num;
+                max_pos = p;
+            }
+        }
+
+        Rect rect(max_pos % out_cols + m_roi.x, max_pos / out_cols + m_roi.y, templ_size.width, templ_size.height);
+#ifdef ASST_DEBUG
+        if (m_log_tracing && max_val > 0.5) { // 得分太低的肯定不对，没必要打印
+            Log.trace("match_templ |", m_templs[k].name, "score:", max_val, "rect:", rect, "roi:", m_roi);
+        }
+#endif
+        if (max_val < threshold) {
+            continue;
+        }
+        if (result.score < max_val) {
+            result = Result { .rect = rect, .score = max_val, .templ_info = m_templs[k] };
+        }
+    }
+    return true;
+}
@@ -34,6 +34,8 @@ namespace asst
         virtual ~BestMatcher() override = default;
 
         void append_templ(std::string name, const cv::Mat& templ = cv::Mat());
+        // 模板尺寸一致且不用掩码时，把所有模板拼成一个矩阵，用一次矩阵乘法算出全部得分（默认开启）
+        void set_batch_match(bool enable) noexcept { m_batch_match = enable; }
 
         ResultOpt analyze() const;
         // FIXME: 老接口太难重构了，先弄个这玩意兼容下，后续慢慢全删掉
@@ -45,7 +47,11 @@ namespace asst
     private:
         using MatcherConfig::set_templ;
 
+        // 不满足批量匹配的条件时返回 false，由调用方逐个模板匹配
+        bool batch_analyze(Result& result) const;
+
         std::vector<TemplInfo> m_templs;
+        bool m_batch_match = true;
         // FIXME: 老接口太难重构了，先弄个这玩意兼容下，后续慢慢全删掉
         mutable Result m_result;
     };
@@ -17,6 +17,8 @@ namespace asst
             std::pair<int, int> mask_range;
             bool mask_with_src = false;
             bool mask_with_close = false;
+            int pyramid_levels = 0;
+            double pyramid_tolerance = 0.1;
         };
 
     public:
@@ -33,6 +35,8 @@ namespace asst
         void set_threshold(double templ_thres) noexcept;
         void set_threshold(std::vector<double> templ_thres) noexcept;
         void set_mask_range(int lower, int upper, bool mask_with_src = false, bool mask_with_close = false);
+        // 先在缩小 levels 层的图上粗匹配，再只在候选位置附近做原图匹配
+        void set_pyramid(int levels, double tolerance = 0.1) noexcept;
 
     protected:
         virtual void _set_roi(const Rect& roi) = 0;
@@ -10,24 +10,15 @@ void OCRerConfig::set_params(Params params)
     m_params = std::move(params);
 }
 
-void OCRerConfig::set_required(std::vector<std::string> required) noexcept
+void OCRerConfig::set_required(const std::vector<std::string>& required)
 {
-    ranges::transform(required, required.begin(),
-                      [](const std::string& str) { return OcrConfig::get_instance().process_equivalence_class(str); });
-    m_params.required = std::move(required);
+    // 编译结果按规则内容缓存在 OcrConfig 里，每帧重复 set 同样的规则不会重复编译
+    m_params.required = required.empty() ? nullptr : OcrConfig::get_instance().get_required_matcher(required);
 }
 
-void OCRerConfig::set_replace(const std::vector<std::pair<std::string, std::string>>& replace,
-                              bool replace_full) noexcept
+void OCRerConfig::set_replace(const std::vector<std::pair<std::string, std::string>>& replace, bool replace_full)
 {
-    m_params.replace.clear();
-    m_params.replace.reserve(replace.size());
-
-    for (auto&& [key, val] : replace) {
-        auto new_key = OcrConfig::get_instance().process_equivalence_class(key);
-        // do not create new_val as val is user-provided, and can avoid issues like 夕 and katakana タ
-        m_params.replace.emplace_back(std::make_pair(std::move(new_key), val));
-    }
+    m_params.replace = replace.empty() ? nullptr : OcrConfig::get_instance().get_replacer(replace);
     m_params.replace_full = replace_full;
 }
 
@@ -51,6 +42,16 @@ void OCRerConfig::set_use_char_model(bool enable) noexcept
     m_params.use_char_model = enable;
 }
 
+void OCRerConfig::set_use_cache(bool enable) noexcept
+{
+    m_params.use_cache = enable;
+}
+
+void OCRerConfig::set_digit_set(std::string digit_set) noexcept
+{
+    m_params.digit_set = std::move(digit_set);
+}
+
 void OCRerConfig::set_bin_threshold(int lower, int upper)
 {
     m_params.bin_threshold_lower = lower;
@@ -70,11 +71,13 @@ void asst::OCRerConfig::set_bin_trim_threshold(int left, int right)
 
 void OCRerConfig::_set_task_info(OcrTaskInfo task_info)
 {
-    set_required(std::move(task_info.text));
+    set_required(task_info.text);
     m_params.full_match = task_info.full_match;
     set_replace(task_info.replace_map, task_info.replace_full);
     m_params.use_char_model = task_info.is_ascii;
     m_params.without_det = task_info.without_det;
+    m_params.use_cache = task_info.use_ocr_cache;
+    m_params.digit_set = task_info.use_digit_ocr ? task_info.name : std::string();
 
     _set_roi(task_info.roi);
 }
@@ -7,17 +7,22 @@
 
 namespace asst
 {
+    class OcrReplacer;
+    class OcrRequiredMatcher;
+
     class OCRerConfig
     {
     public:
         struct Params
         {
-            std::vector<std::string> required;
+            std::shared_ptr<const OcrRequiredMatcher> required; // 为空表示不过滤
             bool full_match = false;
-            std::vector<std::pair<std::string, std::string>> replace;
+            std::shared_ptr<const OcrReplacer> replace; // 为空表示不替换
             bool replace_full = false;
             bool without_det = false;
             bool use_char_model = false;
+            bool use_cache = false;
+            std::string digit_set; // 非空时先用 DigitRecognizer 识别，字形样本按这个名字存取；仅 without_det 时有效
 
             int bin_threshold_lower = 140;
             int bin_threshold_upper = 255;
@@ -32,15 +37,16 @@ namespace asst
 
         void set_params(Params params);
 
-        void set_required(std::vector<std::string> required) noexcept;
-        void set_replace(const std::vector<std::pair<std::string, std::string>>& replace,
-                         bool replace_full = false) noexcept;
+        void set_required(const std::vector<std::string>& required);
+        void set_replace(const std::vector<std::pair<std::string, std::string>>& replace, bool replace_full = false);
 
         virtual void set_task_info(std::shared_ptr<TaskInfo> task_ptr);
         virtual void set_task_info(const std::string& task_name);
 
         void set_without_det(bool without_det) noexcept;
         void set_use_char_model(bool enable) noexcept;
+        void set_use_cache(bool enable) noexcept;
+        void set_digit_set(std::string digit_set) noexcept;
 
         void set_bin_threshold(int lower, int upper = 255);
         void set_bin_expansion(int expansion);
@@ -0,0 +1,225 @@
+#include "DigitRecognizer.h"
+
+#include <algorithm>
+#include <cctype>
+#include <mutex>
+#include <unordered_set>
+
+#include "Utils/NoWarningCV.h"
+
+#include "Utils/Logger.hpp"
+#include "Utils/Ranges.hpp"
+#include "Vision/FrameCache.h"
+
+using namespace asst;
+
+std::optional<TextRect> DigitRecognizer::recognize(const std::string& set, const cv::Mat& image, int bin_lower,
+                                                   int bin_upper) const
+{
+    {
+        // 只认识几个字符的时候，没见过的字符可能会被当成最像的那个，所以学够了才开始用
+        std::shared_lock<std::shared_mutex> lock(m_mutex);
+        auto iter = m_samples.find(set);
+        if (iter == m_samples.end()) {
+            return std::nullopt;
+        }
+        std::unordered_set<char> known_chars;
+        for (const Sample& sample : iter->second) {
+            if (sample.confirmed >= ConfirmCount) {
+                known_chars.emplace(sample.ch);
+            }
+        }
+        if (known_chars.size() < MinKnownChars) {
+            return std::nullopt;
+        }
+    }
+
+    auto glyphs = segment(image, bin_lower, bin_upper);
+    if (glyphs.empty()) {
+        return std::nullopt;
+    }
+
+    std::shared_lock<std::shared_mutex> lock(m_mutex);
+    const auto& samples = m_samples.at(set);
+    std::string text;
+    double min_score = 1.0;
+    for (const cv::Mat& feature : glyphs) {
+        Match match = classify(samples, feature);
+        if (match.score < ScoreThreshold || match.margin < MarginThreshold) {
+            return std::nullopt;
+        }
+        text += match.ch;
+        min_score = std::min(min_score, match.score);
+    }
+
+    return TextRect { .rect = Rect(0, 0, image.cols, image.rows), .score = min_score, .text = std::move(text) };
+}
+
+void DigitRecognizer::learn(const std::string& set, const cv::Mat& image, int bin_lower, int bin_upper,
+                            const std::string& text, double score)
+{
+    if (score < LearnOcrScore || text.empty() || text.size() > MaxGlyphs) {
+        return;
+    }
+    if (!ranges::all_of(text, [](char c) { return std::isgraph(static_cast<unsigned char>(c)) != 0; })) {
+        // 中文（如 "万"）、空格之类的不学，这样的串以后也总是交给 OCR
+        return;
+    }
+
+    auto glyphs = segment(image, bin_lower, bin_upper);
+    if (glyphs.size() != text.size()) {
+        return;
+    }
+
+    std::unique_lock<std::shared_mutex> lock(m_mutex);
+    auto& samples = m_samples[set];
+
+    // 先整串检查一遍：某个字形已经很确定地像另一个字符，说明 OCR 或者切分有问题，整串都不学
+    for (size_t i = 0; i != glyphs.size(); ++i) {
+        Match match = classify(samples, glyphs[i]);
+        if (match.ch != 0 && match.ch != text[i] && match.score >= ScoreThreshold) {
+            Log.warn(__FUNCTION__, "conflict with samples, skip", set, text, "at", i, "like", std::string(1, match.ch),
+                     match.score);
+            return;
+        }
+    }
+
+    size_t learned = 0;
+    for (size_t i = 0; i != glyphs.size(); ++i) {
+        const cv::Mat& feature = glyphs[i];
+        if (Match match = classify(samples, feature); match.ch == text[i] && match.score >= DuplicateScore) {
+            continue;
+        }
+
+        // 找最像的待定样本：同一个字符的算一次认同，不同字符的说明两次 OCR 结果不一致，那个待定样本不能要了
+        auto best_iter = samples.end();
+        double best_score = DuplicateScore;
+        for (auto iter = samples.begin(); iter != samples.end(); ++iter) {
+            if (iter->confirmed >= ConfirmCount) {
+                continue;
+            }
+            if (double score = feature.dot(iter->feature); score >= best_score) {
+                best_iter = iter;
+                best_score = score;
+            }
+        }
+        if (best_iter != samples.end()) {
+            if (best_iter->ch != text[i]) {
+                Log.warn(__FUNCTION__, "ocr disagrees, drop pending sample", set, std::string(1, best_iter->ch), "->",
+                         std::string(1, text[i]));
+                samples.erase(best_iter);
+            }
+            else if (best_score < IdenticalScore && ++best_iter->confirmed >= ConfirmCount) {
+                ++learned;
+            }
+            continue;
+        }
+
+        if (static_cast<size_t>(ranges::count(samples, text[i], &Sample::ch)) >= MaxSamplesPerChar) {
+            continue;
+        }
+        samples.emplace_back(Sample { .ch = text[i], .feature = feature });
+    }
+    if (learned != 0) {
+        Log.trace(__FUNCTION__, set, "confirmed from", text, ", samples:", samples.size());
+    }
+}
+
+std::vector<cv::Mat> DigitRecognizer::segment(const cv::Mat& image, int bin_lower, int bin_upper)
+{
+    if (image.empty()) {
+        return {};
+    }
+
+    cv::Mat bin;
+    cv::inRange(FrameCache::get_instance().gray(image), bin_lower, bin_upper, bin);
+
+    // 整行文字的上下边界，各个字形都按这个高度缩放，保留 '.'、'-' 这类字符的位置信息
+    cv::Mat row_proj;
+    cv::reduce(bin, row_proj, 1, cv::REDUCE_MAX);
+    int top = 0;
+    int bottom = row_proj.rows;
+    while (top < bottom && row_proj.at<uchar>(top) == 0) {
+        ++top;
+    }
+    while (bottom > top && row_proj.at<uchar>(bottom - 1) == 0) {
+        --bottom;
+    }
+    if (top >= bottom) {
+        return {};
+    }
+    const int line_height = bottom - top;
+
+    cv::Mat col_proj;
+    cv::reduce(bin, col_proj, 0, cv::REDUCE_MAX);
+
+    std::vector<cv::Mat> glyphs;
+    for (int x = 0; x < col_proj.cols;) {
+        if (col_proj.at<uchar>(x) == 0) {
+            ++x;
+            continue;
+        }
+        int end = x;
+        while (end < col_proj.cols && col_proj.at<uchar>(end) != 0) {
+            ++end;
+        }
+        cv::Mat glyph = bin(cv::Rect(x, top, end - x, line_height));
+        x = end;
+        // 单个像素的噪点直接丢掉
+        if (cv::countNonZero(glyph) < 2) {
+            continue;
+        }
+        if (glyphs.size() == MaxGlyphs) {
+            return {};
+        }
+
+        // 按整行高度等比缩放，宽度超出的再压一下，放在方框中间
+        const double scale = static_cast<double>(GlyphSize) / line_height;
+        const int width = std::clamp(static_cast<int>(glyph.cols * scale + 0.5), 1, GlyphSize);
+        cv::Mat resized;
+        cv::resize(glyph, resized, cv::Size(width, GlyphSize), 0, 0, cv::INTER_AREA);
+        cv::Mat feature = cv::Mat::zeros(GlyphSize, GlyphSize, CV_32F);
+        resized.convertTo(feature(cv::Rect((GlyphSize - width) / 2, 0, width, GlyphSize)), CV_32F);
+
+        feature -= cv::mean(feature)[0];
+        const double norm = cv::norm(feature);
+        if (norm < 1e-6) {
+            // 铺满整个方框的实心块，没有区分度
+            return {};
+        }
+        feature /= norm;
+        glyphs.emplace_back(std::move(feature));
+    }
+    return glyphs;
+}
+
+DigitRecognizer::Match DigitRecognizer::classify(const std::vector<Sample>& samples, const cv::Mat& feature)
+{
+    // 每个字符取其所有样本里的最高分，再比较不同字符之间的差距
+    std::unordered_map<char, double> best_of_char;
+    for (const Sample& sample : samples) {
+        if (sample.confirmed < ConfirmCount) {
+            continue;
+        }
+        double score = feature.dot(sample.feature);
+        auto [iter, inserted] = best_of_char.try_emplace(sample.ch, score);
+        if (!inserted) {
+            iter->second = std::max(iter->second, score);
+        }
+    }
+
+    Match match;
+    double second = -1.0;
+    for (const auto& [ch, score] : best_of_char) {
+        if (match.ch == 0 || score > match.score) {
+            second = match.ch == 0 ? second : match.score;
+            match.ch = ch;
+            match.score = score;
+        }
+        else {
+            second = std::max(second, score);
+        }
+    }
+    match.margin = match.score - second;
+    return match;
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Common/AsstTypes.h"
+#include "Utils/NoWarningCVMat.h"
+#include "Utils/SingletonHolder.hpp"
+
+namespace asst
+{
+    // 只有数字（及 '/' 之类少数 ASCII 符号）的短文本的快速识别
+    // 按列投影把二值图切成单个字形，缩放到固定大小后与样本逐个比相关系数，整个过程只要几十微秒
+    // 字形样本不需要事先准备：OCR 识别结果可信时，把切出来的字形按对应的字符记下来，之后就能直接认了
+    // OCR 偶尔也会认错（比如把 '/' 认成 '1'），所以新样本要被不同的截图上的 OCR 结果再认同几次才会启用
+    // 样本按 set 分开存，同一个 set 里的字体、字号、预处理都应该一致，不同的调用处请用不同的 set
+    class DigitRecognizer final : public SingletonHolder<DigitRecognizer>
+    {
+    public:
+        static constexpr int GlyphSize = 16;             // 字形统一缩放到 GlyphSize * GlyphSize
+        static constexpr size_t MaxGlyphs = 12;          // 切出来的字形比这还多，多半不是数字串
+        static constexpr size_t MaxSamplesPerChar = 4;   // 每个字符最多记几个样本
+        static constexpr size_t MinKnownChars = 10;      // 学到的字符少于这么多时还在学习期，全都交给 OCR
+        static constexpr double ScoreThreshold = 0.9;    // 单个字形的相关系数低于该值认为不认识
+        static constexpr double MarginThreshold = 0.05;  // 最像的字符与次像的字符得分差不够大，也认为不认识
+        static constexpr double LearnOcrScore = 0.9;     // OCR 得分不低于该值时才拿来学习
+        static constexpr double DuplicateScore = 0.97;   // 与已有样本这么像就不用再记了
+        static constexpr double IdenticalScore = 0.999;  // 这么像基本就是同一张图，OCR 结果一样也不算再次认同
+        static constexpr size_t ConfirmCount = 3;        // 样本被 OCR 认同这么多次（含第一次）后才用来识别
+
+    public:
+        virtual ~DigitRecognizer() override = default;
+
+        // 全部字形都认得出来时返回整串文字，score 为各字形得分的最小值，rect 为整张图
+        // 有字形不认识、或把握不够时返回 std::nullopt，由调用方回退到 OCR
+        std::optional<TextRect> recognize(const std::string& set, const cv::Mat& image, int bin_lower,
+                                          int bin_upper) const;
+        // 用 OCR 的结果学习字形：字形个数与文字长度一致且没有冲突时，才把各字形记为对应字符的待定样本
+        // 待定样本被之后的 OCR 结果认同够 ConfirmCount 次才启用；OCR 给出不同的字符时直接丢弃
+        void learn(const std::string& set, const cv::Mat& image, int bin_lower, int bin_upper,
+                   const std::string& text, double score);
+
+    private:
+        friend class SingletonHolder<DigitRecognizer>;
+        DigitRecognizer() = default;
+
+        struct Sample
+        {
+            char ch = 0;
+            cv::Mat feature;         // CV_32F，GlyphSize * GlyphSize，减去均值并归一化
+            size_t confirmed = 1;    // 被 OCR 认同的次数，不少于 ConfirmCount 时才启用
+        };
+        struct Match
+        {
+            char ch = 0;
+            double score = 0;
+            double margin = 0; // 与次像的字符的得分差
+        };
+
+        // 切出的字形按从左到右排列；切不出来或字形太多时返回空
+        static std::vector<cv::Mat> segment(const cv::Mat& image, int bin_lower, int bin_upper);
+        // 只和已启用的样本比，待定的样本不参与
+        static Match classify(const std::vector<Sample>& samples, const cv::Mat& feature);
+
+        mutable std::shared_mutex m_mutex;
+        std::unordered_map<std::string, std::vector<Sample>> m_samples;
+    };
+}
@@ -0,0 +1,161 @@
+#include "FrameCache.h"
+
+#include "Utils/NoWarningCV.h"
+
+using namespace asst;
+
+template <typename Getter, typename Maker>
+cv::Mat FrameCache::get_or_make(const cv::Mat& image, Getter getter, Maker maker)
+{
+    cv::Rect roi;
+    auto frame = locate(image, roi);
+    if (!frame) {
+        return maker(image);
+    }
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        if (const cv::Mat& cached = getter(*frame); !cached.empty()) {
+            return cached(roi);
+        }
+    }
+    // 颜色转换、阈值都是逐像素的，对整帧算一次，之后任何 roi 都能直接裁出来
+    cv::Mat made = maker(frame->whole);
+    std::unique_lock<std::mutex> lock(m_mutex);
+    cv::Mat& cached = getter(*frame);
+    if (cached.empty()) {
+        cached = std::move(made);
+    }
+    return cached(roi);
+}
+
+cv::Mat FrameCache::gray(const cv::Mat& image)
+{
+    if (image.channels() == 1) {
+        return image;
+    }
+    return get_or_make(
+        image, [](Frame& frame) -> cv::Mat& { return frame.gray; },
+        [](const cv::Mat& src) {
+            cv::Mat dst;
+            cv::cvtColor(src, dst, cv::COLOR_BGR2GRAY);
+            return dst;
+        });
+}
+
+cv::Mat FrameCache::hsv(const cv::Mat& image)
+{
+    return get_or_make(
+        image, [](Frame& frame) -> cv::Mat& { return frame.hsv; },
+        [](const cv::Mat& src) {
+            cv::Mat dst;
+            cv::cvtColor(src, dst, cv::COLOR_BGR2HSV);
+            return dst;
+        });
+}
+
+cv::Mat FrameCache::gray_bin(const cv::Mat& image, int lower, int upper)
+{
+    const auto key = std::make_pair(lower, upper);
+    return get_or_make(
+        image, [&](Frame& frame) -> cv::Mat& { return frame.gray_bins[key]; },
+        [&](const cv::Mat& src) {
+            cv::Mat dst;
+            cv::inRange(gray(src), lower, upper, dst);
+            return dst;
+        });
+}
+
+cv::Mat FrameCache::pyr_down(const cv::Mat& image, int levels)
+{
+    auto make = [&]() {
+        cv::Mat dst = image;
+        for (int i = 0; i < levels; ++i) {
+            cv::pyrDown(dst, dst);
+        }
+        return dst;
+    };
+    if (levels <= 0) {
+        return image;
+    }
+
+    cv::Rect roi;
+    auto frame = locate(image, roi);
+    if (!frame) {
+        return make();
+    }
+    const auto key = std::make_tuple(roi.x, roi.y, roi.width, roi.height, levels);
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        if (auto iter = frame->pyramids.find(key); iter != frame->pyramids.end()) {
+            return iter->second;
+        }
+    }
+    cv::Mat dst = make();
+    std::unique_lock<std::mutex> lock(m_mutex);
+    return frame->pyramids.try_emplace(key, std::move(dst)).first->second;
+}
+
+void FrameCache::add_frame(const void* owner, size_t frame_id, const cv::Mat& frame)
+{
+    if (frame.empty() || frame.dims != 2 || frame.u == nullptr || !frame.isContinuous()) {
+        return;
+    }
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for (const auto& cached : m_frames) {
+        if (cached->owner == owner && cached->frame_id == frame_id && cached->whole.datastart == frame.datastart) {
+            return;
+        }
+    }
+    // 只淘汰同一个实例的旧帧，多开时不同实例之间互不影响
+    std::erase_if(m_frames, [&](const std::shared_ptr<Frame>& cached) {
+        return cached->owner == owner && cached->frame_id + MaxFramesPerOwner <= frame_id;
+    });
+
+    auto added = std::make_shared<Frame>();
+    added->owner = owner;
+    added->frame_id = frame_id;
+    added->whole = frame;
+    m_frames.emplace_front(std::move(added));
+}
+
+void FrameCache::clear()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_frames.clear();
+}
+
+void FrameCache::clear(const void* owner)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    std::erase_if(m_frames, [&](const std::shared_ptr<Frame>& cached) { return cached->owner == owner; });
+}
+
+std::shared_ptr<FrameCache::Frame> FrameCache::locate(const cv::Mat& image, cv::Rect& roi_in_frame)
+{
+    if (image.empty() || image.dims != 2 || image.u == nullptr) {
+        return nullptr;
+    }
+
+    cv::Size whole_size;
+    cv::Point offset;
+    image.locateROI(whole_size, offset);
+    roi_in_frame = cv::Rect(offset, image.size());
+
+    // 登记过的帧由 FrameCache 持有引用，缓冲区不会被释放后另作他用，datastart 相同就是同一帧
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for (auto iter = m_frames.begin(); iter != m_frames.end(); ++iter) {
+        const cv::Mat& whole = (*iter)->whole;
+        if (whole.datastart == image.datastart && whole.size() == whole_size && whole.type() == image.type()) {
+            m_frames.splice(m_frames.begin(), m_frames, iter);
+            return m_frames.front();
+        }
+    }
+    return nullptr;
+}
+
+std::string FrameCache::result_key(const std::string& key, const cv::Rect& roi_in_frame)
+{
+    return key + "@" + std::to_string(roi_in_frame.x) + "," + std::to_string(roi_in_frame.y) + "," +
+           std::to_string(roi_in_frame.width) + "," + std::to_string(roi_in_frame.height);
+}
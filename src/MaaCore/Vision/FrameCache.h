@@ -0,0 +1,114 @@
+#pragma once
+
+#include <any>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+
+#include "Utils/NoWarningCVMat.h"
+#include "Utils/SingletonHolder.hpp"
+
+namespace asst
+{
+    // 同一帧截图的派生图缓存（灰度、HSV、固定阈值二值化、下采样金字塔）
+    // 一帧截图往往会被十几个识别器反复转换颜色空间，这里按帧记下第一次算出来的结果，之后直接复用
+    // 只缓存 Controller 交出来的帧（见 add_frame），按 实例 + 帧号 区分；其他来源的图（clone、自己读的图）不缓存
+    // 传入的 image 可以是截图本身，也可以是截图上的一块 roi，返回的图与 image 同样大小
+    // 返回的图是共享的，调用方不要原地修改；截图本身也一样，被缓存期间不能原地修改
+    class FrameCache final : public SingletonHolder<FrameCache>
+    {
+    public:
+        // 每个实例保留最近的这么多帧：当前帧，和可能还在被识别的上一帧
+        static constexpr size_t MaxFramesPerOwner = 2;
+
+    public:
+        virtual ~FrameCache() override = default;
+
+        // Controller 每次交出截图时登记一下，owner 为 Controller 实例，frame_id 为它的帧号
+        // 同一个 owner 登记了新的帧以后，更旧的帧会被移除
+        void add_frame(const void* owner, size_t frame_id, const cv::Mat& frame);
+
+        cv::Mat gray(const cv::Mat& image);
+        cv::Mat hsv(const cv::Mat& image);
+        // 灰度图 inRange(lower, upper) 的结果
+        cv::Mat gray_bin(const cv::Mat& image, int lower, int upper);
+        // 连续 pyrDown levels 次。金字塔不是逐像素运算，不同 roi 的结果不能互相裁剪得到，所以按 roi 缓存
+        cv::Mat pyr_down(const cv::Mat& image, int levels);
+
+        // 同一帧上的识别结果备忘，换了新截图自然就查不到了
+        // key 由调用方保证包含会影响结果的全部参数，image 在整帧中的位置会自动拼进 key
+        template <typename T>
+        std::optional<T> get_result(const cv::Mat& image, const std::string& key);
+        template <typename T>
+        void set_result(const cv::Mat& image, const std::string& key, T value);
+
+        void clear();
+        // 移除某个实例登记的全部帧，实例析构时调用
+        void clear(const void* owner);
+
+    private:
+        friend class SingletonHolder<FrameCache>;
+        FrameCache() = default;
+
+        struct Frame
+        {
+            const void* owner = nullptr;
+            size_t frame_id = 0;
+            cv::Mat whole; // 持有整帧截图的引用，保证缓存期间缓冲区不会被释放后再分配给下一帧
+            cv::Mat gray;
+            cv::Mat hsv;
+            std::map<std::pair<int, int>, cv::Mat> gray_bins;
+            std::map<std::tuple<int, int, int, int, int>, cv::Mat> pyramids;
+            std::unordered_map<std::string, std::any> results;
+        };
+
+        static std::string result_key(const std::string& key, const cv::Rect& roi_in_frame);
+
+        // 找到 image 所在的、已登记的整帧截图；不是登记过的帧（或帧上的 roi）时返回 nullptr，此时不做缓存
+        std::shared_ptr<Frame> locate(const cv::Mat& image, cv::Rect& roi_in_frame);
+        // 取整帧派生图，没有就在锁外算出来再放进去，避免多个识别器同时等一把锁
+        template <typename Getter, typename Maker>
+        cv::Mat get_or_make(const cv::Mat& image, Getter getter, Maker maker);
+
+        std::mutex m_mutex;
+        std::list<std::shared_ptr<Frame>> m_frames; // 最近用过的在前面
+    };
+
+    template <typename T>
+    inline std::optional<T> FrameCache::get_result(const cv::Mat& image, const std::string& key)
+    {
+        cv::Rect roi;
+        auto frame = locate(image, roi);
+        if (!frame) {
+            return std::nullopt;
+        }
+        std::unique_lock<std::mutex> lock(m_mutex);
+        auto iter = frame->results.find(result_key(key, roi));
+        if (iter == frame->results.end()) {
+            return std::nullopt;
+        }
+        const T* value = std::any_cast<T>(&iter->second);
+        if (!value) {
+            return std::nullopt;
+        }
+        return *value;
+    }
+
+    template <typename T>
+    inline void FrameCache::set_result(const cv::Mat& image, const std::string& key, T value)
+    {
+        cv::Rect roi;
+        auto frame = locate(image, roi);
+        if (!frame) {
+            return;
+        }
+        std::unique_lock<std::mutex> lock(m_mutex);
+        frame->results.insert_or_assign(result_key(key, roi), std::move(value));
+    }
+}
@@ -0,0 +1,46 @@
+#include "FrameChangeDetector.h"
+
+#include "Utils/NoWarningCV.h"
+
+using namespace asst;
+
+bool FrameChangeDetector::changed(const cv::Mat& image)
+{
+    cv::Mat signature = make_signature(image, m_roi);
+    ++m_checked;
+    if (is_similar(signature, m_signature)) {
+        ++m_unchanged;
+        return false;
+    }
+    m_signature = std::move(signature);
+    return true;
+}
+
+cv::Mat FrameChangeDetector::make_signature(const cv::Mat& image, const Rect& roi)
+{
+    if (image.empty()) {
+        return {};
+    }
+    cv::Rect cv_roi = roi.empty() ? cv::Rect(0, 0, image.cols, image.rows) : make_rect<cv::Rect>(roi);
+    cv_roi &= cv::Rect(0, 0, image.cols, image.rows);
+    if (cv_roi.empty()) {
+        return {};
+    }
+
+    const cv::Size blocks((cv_roi.width + BlockSize - 1) / BlockSize, (cv_roi.height + BlockSize - 1) / BlockSize);
+    cv::Mat signature;
+    cv::resize(image(cv_roi), signature, blocks, 0, 0, cv::INTER_AREA);
+    return signature;
+}
+
+bool FrameChangeDetector::is_similar(const cv::Mat& lhs, const cv::Mat& rhs)
+{
+    if (lhs.empty() || rhs.empty() || lhs.size() != rhs.size() || lhs.type() != rhs.type()) {
+        return false;
+    }
+    cv::Mat diff;
+    cv::absdiff(lhs, rhs, diff);
+    double max_diff = 0;
+    cv::minMaxLoc(diff.reshape(1), nullptr, &max_diff);
+    return max_diff <= Tolerance;
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "Common/AsstTypes.h"
+#include "Utils/NoWarningCVMat.h"
+
+namespace asst
+{
+    // 判断画面的某个 roi 与上一次相比有没有变化，没变化的帧可以直接沿用上次的识别结果
+    // 做法是把 roi 按 BlockSize 分块求均值，逐块比较，比逐像素比较便宜得多，又能发现小图标的出现和消失
+    class FrameChangeDetector
+    {
+    public:
+        static constexpr int BlockSize = 8;
+        static constexpr int Tolerance = 2; // 分块均值允许的差异，容忍编码/缩放带来的细微噪声
+
+        FrameChangeDetector() = default;
+        explicit FrameChangeDetector(const Rect& roi) : m_roi(roi) {}
+
+        // 与上次调用时的画面相比是否有变化，第一次调用总是返回 true
+        bool changed(const cv::Mat& image);
+        void reset() noexcept { m_signature = cv::Mat(); }
+
+        size_t checked_count() const noexcept { return m_checked; }
+        size_t unchanged_count() const noexcept { return m_unchanged; }
+
+        static cv::Mat make_signature(const cv::Mat& image, const Rect& roi = Rect());
+        static bool is_similar(const cv::Mat& lhs, const cv::Mat& rhs);
+
+    private:
+        Rect m_roi;
+        cv::Mat m_signature;
+        size_t m_checked = 0;
+        size_t m_unchanged = 0;
+    };
+}
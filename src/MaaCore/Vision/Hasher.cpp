@@ -1,11 +1,14 @@
 #include "Hasher.h"
 
+#include <bit>
+
 #include "Utils/NoWarningCV.h"
 
 #include "Utils/Logger.hpp"
 
 bool asst::Hasher::analyze()
 {
+    m_hash_bits_result.clear();
     m_hash_result.clear();
     m_min_dist_name.clear();
 
@@ -14,7 +17,7 @@ bool asst::Hasher::analyze()
     if (m_mask_range.first != 0 || m_mask_range.second != 0) {
         cv::Mat bin;
         if (roi.channels() == 3) {
-            cv::cvtColor(roi, roi, cv::COLOR_BGR2GRAY);
+            roi = gray_of(roi);
         }
         cv::inRange(roi, m_mask_range.first, m_mask_range.second, bin);
         roi = bin;
@@ -32,21 +35,16 @@ bool asst::Hasher::analyze()
         if (m_need_bound) {
             to_hash = bound_bin(to_hash);
         }
-        std::string hash_result = s_hash(to_hash);
-        // Log.debug(hash_result);
-
-        int min_dist = INT_MAX;
-        std::string cur_min_dist_name;
-        for (auto&& [name, templ] : m_hash_templates) {
-            int hm = hamming(hash_result, templ);
-            // Log.debug(name, "dist:", hm);
-            if (hm < min_dist) {
-                cur_min_dist_name = name;
-                min_dist = hm;
-            }
+        HashBits hash_result = s_hash_bits(to_hash);
+
+        if (m_hash_templates) {
+            m_min_dist_name.emplace_back(m_hash_templates->nearest(hash_result).first);
+        }
+        else {
+            m_min_dist_name.emplace_back();
         }
-        m_min_dist_name.emplace_back(std::move(cur_min_dist_name));
-        m_hash_result.emplace_back(std::move(hash_result));
+        m_hash_result.emplace_back(to_hash_string(hash_result));
+        m_hash_bits_result.emplace_back(hash_result);
     }
 
     return true;
@@ -62,7 +60,16 @@ void asst::Hasher::set_mask_range(std::pair<int, int> mask_range) noexcept
     m_mask_range = std::move(mask_range);
 }
 
-void asst::Hasher::set_hash_templates(std::unordered_map<std::string, std::string> hash_templates) noexcept
+void asst::Hasher::set_hash_templates(std::unordered_map<std::string, std::string> hash_templates)
+{
+    auto hash_index = std::make_shared<HashIndex>();
+    for (auto&& [name, hash] : hash_templates) {
+        hash_index->insert(name, to_hash_bits(hash));
+    }
+    m_hash_templates = std::move(hash_index);
+}
+
+void asst::Hasher::set_hash_templates(std::shared_ptr<const HashIndex> hash_templates) noexcept
 {
     m_hash_templates = std::move(hash_templates);
 }
@@ -87,7 +94,12 @@ const std::vector<std::string>& asst::Hasher::get_hash() const noexcept
     return m_hash_result;
 }
 
-std::string asst::Hasher::s_hash(const cv::Mat& img)
+const std::vector<asst::Hasher::HashBits>& asst::Hasher::get_hash_bits() const noexcept
+{
+    return m_hash_bits_result;
+}
+
+asst::HashBits asst::Hasher::s_hash_bits(const cv::Mat& img)
 {
     static constexpr int HashKernelSize = 16;
     cv::Mat resized;
@@ -97,19 +109,112 @@ std::string asst::Hasher::s_hash(const cv::Mat& img)
         cv::cvtColor(resized, temp, cv::COLOR_BGR2GRAY);
         resized = temp;
     }
-    std::stringstream hash_value;
-    uchar* pix = resized.data;
-    int tmp_dec = 0;
-    for (int ro = 0; ro < 256; ro++) {
-        tmp_dec = tmp_dec << 1;
-        if (*pix > 127) tmp_dec++;
-        if (ro % 4 == 3) {
-            hash_value << std::hex << tmp_dec;
-            tmp_dec = 0;
+    HashBits hash {};
+    for (int ro = 0; ro < HashKernelSize * HashKernelSize; ++ro) {
+        const uchar pix = resized.at<uchar>(ro / HashKernelSize, ro % HashKernelSize);
+        hash[ro / 64] = (hash[ro / 64] << 1) | (pix > 127 ? 1 : 0);
+    }
+    return hash;
+}
+
+std::string asst::Hasher::s_hash(const cv::Mat& img)
+{
+    return to_hash_string(s_hash_bits(img));
+}
+
+asst::HashBits asst::Hasher::to_hash_bits(const std::string& hash)
+{
+    static constexpr size_t HexDigits = 64;
+    std::string padded = hash;
+    if (padded.size() < HexDigits) {
+        padded.insert(padded.begin(), HexDigits - padded.size(), '0');
+    }
+    HashBits bits {};
+    for (size_t i = 0; i < bits.size(); ++i) {
+        bits[i] = strtoull(padded.substr(i * 16, 16).c_str(), nullptr, 16);
+    }
+    return bits;
+}
+
+std::string asst::Hasher::to_hash_string(const HashBits& hash)
+{
+    // 和以前的 stringstream 版本一致：每 4 位一个十六进制字符，共 64 个
+    static constexpr char HexChars[] = "0123456789abcdef";
+    std::string result;
+    result.reserve(64);
+    for (uint64_t word : hash) {
+        for (int shift = 60; shift >= 0; shift -= 4) {
+            result.push_back(HexChars[(word >> shift) & 0xF]);
+        }
+    }
+    return result;
+}
+
+int asst::Hasher::hamming(const HashBits& hash1, const HashBits& hash2) noexcept
+{
+    int dist = 0;
+    for (size_t i = 0; i < hash1.size(); ++i) {
+        dist += std::popcount(hash1[i] ^ hash2[i]);
+    }
+    return dist;
+}
+
+int asst::Hasher::hamming(const std::string& hash1, const std::string& hash2)
+{
+    return hamming(to_hash_bits(hash1), to_hash_bits(hash2));
+}
+
+void asst::HashIndex::insert(std::string name, const HashBits& hash)
+{
+    const size_t new_index = m_nodes.size();
+    if (m_nodes.empty()) {
+        m_nodes.emplace_back(Node { .name = std::move(name), .hash = hash, .children = {} });
+        return;
+    }
+
+    size_t cur = 0;
+    while (true) {
+        const int dist = Hasher::hamming(m_nodes[cur].hash, hash);
+        auto& children = m_nodes[cur].children;
+        auto iter = ranges::find_if(children, [&](const auto& child) { return child.first == dist; });
+        if (iter == children.end()) {
+            children.emplace_back(dist, new_index);
+            break;
         }
-        pix++;
+        cur = iter->second;
     }
-    return hash_value.str();
+    m_nodes.emplace_back(Node { .name = std::move(name), .hash = hash, .children = {} });
+}
+
+std::pair<std::string, int> asst::HashIndex::nearest(const HashBits& hash) const
+{
+    if (m_nodes.empty()) {
+        return { std::string(), INT_MAX };
+    }
+
+    // 三角不等式：子树里的点到 hash 的距离不小于 |dist - edge|，超过当前最优的子树直接剪掉
+    size_t best_index = 0;
+    int best_dist = INT_MAX;
+    std::vector<size_t> stack = { 0 };
+    while (!stack.empty()) {
+        const size_t cur = stack.back();
+        stack.pop_back();
+
+        const int dist = Hasher::hamming(m_nodes[cur].hash, hash);
+        if (dist < best_dist) {
+            best_dist = dist;
+            best_index = cur;
+            if (best_dist == 0) {
+                break;
+            }
+        }
+        for (const auto& [edge, child] : m_nodes[cur].children) {
+            if (std::abs(edge - dist) < best_dist) {
+                stack.emplace_back(child);
+            }
+        }
+    }
+    return { m_nodes[best_index].name, best_dist };
 }
 
 std::vector<cv::Mat> asst::Hasher::split_bin(const cv::Mat& bin)
@@ -151,21 +256,3 @@ cv::Mat asst::Hasher::bound_bin(const cv::Mat& bin)
 {
     return bin(cv::boundingRect(bin));
 }
-
-int asst::Hasher::hamming(std::string hash1, std::string hash2)
-{
-    static constexpr int HammingFlags = 64;
-
-    hash1.insert(hash1.begin(), HammingFlags - hash1.size(), '0');
-    hash2.insert(hash2.begin(), HammingFlags - hash2.size(), '0');
-    int dist = 0;
-    for (int i = 0; i < HammingFlags; i = i + 16) {
-        unsigned long long x =
-            strtoull(hash1.substr(i, 16).c_str(), nullptr, 16) ^ strtoull(hash2.substr(i, 16).c_str(), nullptr, 16);
-        while (x) {
-            ++dist;
-            x = x & (x - 1);
-        }
-    }
-    return dist;
-}
@@ -1,10 +1,36 @@
 #pragma once
 #include "VisionHelper.h"
 
+#include <array>
+#include <memory>
 #include <unordered_map>
 
 namespace asst
 {
+    // 16x16 的二值化结果，按行优先每 64 位打包成一个 uint64，bits[0] 的最高位是左上角像素
+    using HashBits = std::array<uint64_t, 4>;
+
+    // 以 BK-tree 组织的 hash 模板集合，最近邻查找不需要遍历所有模板
+    // 任务里配置的 hash 在加载时建好一次（见 HashTaskInfo::hash_index），各个 Hasher 共用
+    class HashIndex
+    {
+    public:
+        void clear() noexcept { m_nodes.clear(); }
+        bool empty() const noexcept { return m_nodes.empty(); }
+        void insert(std::string name, const HashBits& hash);
+        // 返回最近的模板名及距离，集合为空时返回 { "", INT_MAX }
+        std::pair<std::string, int> nearest(const HashBits& hash) const;
+
+    private:
+        struct Node
+        {
+            std::string name;
+            HashBits hash {};
+            std::vector<std::pair<int, size_t>> children; // { 与本结点的距离, 子结点下标 }
+        };
+        std::vector<Node> m_nodes;
+    };
+
     // FIXME: 删掉这个类，以及对应的 task 类型
     class Hasher : public VisionHelper
     {
@@ -16,24 +42,32 @@ namespace asst
 
         void set_mask_range(int lower, int upper) noexcept;
         void set_mask_range(std::pair<int, int> mask_range) noexcept;
-        void set_hash_templates(std::unordered_map<std::string, std::string> hash_templates) noexcept;
+        void set_hash_templates(std::unordered_map<std::string, std::string> hash_templates);
+        void set_hash_templates(std::shared_ptr<const HashIndex> hash_templates) noexcept;
         void set_need_split(bool need_split) noexcept;
         void set_need_bound(bool need_bound) noexcept;
 
         const std::vector<std::string>& get_min_dist_name() const noexcept;
         const std::vector<std::string>& get_hash() const noexcept;
+        const std::vector<HashBits>& get_hash_bits() const noexcept;
 
+        static HashBits s_hash_bits(const cv::Mat& img);
         static std::string s_hash(const cv::Mat& img);
-        static int hamming(std::string hash1, std::string hash2);
+        // 字符串形式（64 位十六进制）与打包形式互相转换，配置文件里仍然用字符串
+        static HashBits to_hash_bits(const std::string& hash);
+        static std::string to_hash_string(const HashBits& hash);
+        static int hamming(const HashBits& hash1, const HashBits& hash2) noexcept;
+        static int hamming(const std::string& hash1, const std::string& hash2);
         static std::vector<cv::Mat> split_bin(const cv::Mat& bin);
         static cv::Mat bound_bin(const cv::Mat& bin);
 
     protected:
         std::pair<int, int> m_mask_range;
-        std::unordered_map<std::string, std::string> m_hash_templates;
+        std::shared_ptr<const HashIndex> m_hash_templates;
         bool m_need_split = false;
         bool m_need_bound = false;
 
+        std::vector<HashBits> m_hash_bits_result;
         std::vector<std::string> m_hash_result;
         std::vector<std::string> m_min_dist_name;
     };
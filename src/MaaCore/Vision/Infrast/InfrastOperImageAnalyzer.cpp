@@ -163,8 +163,7 @@ void asst::InfrastOperImageAnalyzer::mood_analyze()
         roi.x += oper.smiley.rect.x;
         roi.y += oper.smiley.rect.y;
         cv::Mat prg_image = m_image(make_rect<cv::Rect>(roi));
-        cv::Mat prg_gray;
-        cv::cvtColor(prg_image, prg_gray, cv::COLOR_BGR2GRAY);
+        cv::Mat prg_gray = gray_of(prg_image);
 
         int max_white_length = 0; // 最长横扫的白色长度，即作为进度条长度
         for (int i = 0; i != prg_gray.rows; ++i) {
@@ -207,15 +206,17 @@ void asst::InfrastOperImageAnalyzer::face_hash_analyze()
 {
     LogTraceFunction;
 
-    const Rect hash_rect_move = Task.get("InfrastOperFaceHash")->rect_move;
+    const auto hash_task_ptr = Task.get<HashTaskInfo>("InfrastOperFaceHash");
+    const Rect hash_rect_move = hash_task_ptr->rect_move;
 
     Hasher hash_analyzer(m_image);
+    hash_analyzer.set_hash_templates(hash_task_ptr->hash_index);
 
     for (auto&& oper : m_result) {
         Rect roi = oper.smiley.rect.move(hash_rect_move);
         hash_analyzer.set_roi(roi);
         hash_analyzer.analyze();
-        oper.face_hash = hash_analyzer.get_hash().front();
+        oper.face_hash = hash_analyzer.get_hash_bits().front();
     }
 }
 
@@ -254,8 +255,7 @@ void asst::InfrastOperImageAnalyzer::skill_analyze()
             cv::Mat skill_image = all_skills_img(make_rect<cv::Rect>(skill_rect_in_roi));
 
             // 过滤掉亮度阈值不够的，说明是暗的技能（不是当前设施的技能）
-            cv::Mat skill_gray;
-            cv::cvtColor(skill_image, skill_gray, cv::COLOR_BGR2GRAY);
+            cv::Mat skill_gray = gray_of(skill_image);
             cv::Scalar avg = cv::mean(skill_gray, mask);
             if (avg[0] < bright_thres) {
                 continue;
@@ -353,8 +353,8 @@ void asst::InfrastOperImageAnalyzer::selected_analyze()
         selected_rect.y += oper.smiley.rect.y;
 
         cv::Mat roi = m_image(make_rect<cv::Rect>(selected_rect));
-        cv::Mat hsv, bin;
-        cv::cvtColor(roi, hsv, cv::COLOR_BGR2HSV);
+        cv::Mat hsv = hsv_of(roi);
+        cv::Mat bin;
         std::vector<cv::Mat> channels;
         cv::split(hsv, channels);
         int mask_lowb = selected_task_ptr->mask_range.first;
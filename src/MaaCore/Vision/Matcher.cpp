@@ -11,7 +11,20 @@ using namespace asst;
 
 Matcher::ResultOpt Matcher::analyze() const
 {
-    const auto match_results = preproc_and_match(make_roi(m_image, m_roi), m_params);
+    const cv::Mat image = make_roi(m_image, m_roi);
+    // 备忘里存的是相对 roi 的坐标，同一块区域换个 m_image 的裁剪方式也能复用
+    const std::string key = memo_key("Matcher", m_params);
+    if (auto memo = memo_get<ResultOpt>(image, key)) {
+        if (!*memo) {
+            return std::nullopt;
+        }
+        m_result = **memo;
+        m_result.rect.x += m_roi.x;
+        m_result.rect.y += m_roi.y;
+        return m_result;
+    }
+
+    const auto match_results = preproc_and_match(image, m_params);
 
     for (size_t i = 0; i < match_results.size(); ++i) {
         const auto& [matched, templ, templ_name] = match_results[i];
@@ -39,16 +52,20 @@ Matcher::ResultOpt Matcher::analyze() const
         // FIXME: 老接口太难重构了，先弄个这玩意兼容下，后续慢慢全删掉
         m_result.rect = rect;
         m_result.score = max_val;
+        memo_set<ResultOpt>(image, key,
+                            Result { .rect = Rect(max_loc.x, max_loc.y, templ.cols, templ.rows), .score = max_val });
         return m_result;
     }
 
+    memo_set<ResultOpt>(image, key, std::nullopt);
     return std::nullopt;
 }
 
 std::vector<Matcher::RawResult> Matcher::preproc_and_match(const cv::Mat& image, const MatcherConfig::Params& params)
 {
     std::vector<Matcher::RawResult> results;
-    for (auto& ptempl : params.templs) {
+    for (size_t i = 0; i < params.templs.size(); ++i) {
+        const auto& ptempl = params.templs[i];
         cv::Mat templ;
         std::string templ_name;
 
@@ -78,18 +95,33 @@ std::vector<Matcher::RawResult> Matcher::preproc_and_match(const cv::Mat& image,
             return {};
         }
 
+        const bool use_mask = params.mask_range.first != 0 || params.mask_range.second != 0;
+        // 掩码由截图生成时大小和模板不一致，没法跟着模板一起缩放，只能老老实实原图匹配
+        const bool use_pyramid = params.pyramid_levels > 0 && !params.templ_thres.empty() &&
+                                 !(use_mask && params.mask_with_src);
+
+        std::shared_ptr<const TemplArtifacts> artifacts;
+        if ((use_mask && !params.mask_with_src) || use_pyramid) {
+            auto maker = [&](const cv::Mat& t) { return make_templ_artifacts(t, params); };
+            if (templ_name.empty()) {
+                artifacts = std::make_shared<const TemplArtifacts>(maker(templ));
+            }
+            else {
+                artifacts = TemplResource::get_instance().get_artifacts(templ_name, artifacts_key(params), maker);
+            }
+        }
+
+        cv::Mat mask;
+        if (use_mask) {
+            mask = params.mask_with_src ? make_mask(image, params, true) : artifacts->mask;
+        }
+
         cv::Mat matched;
-        if (params.mask_range.first == 0 && params.mask_range.second == 0) {
-            cv::matchTemplate(image, templ, matched, cv::TM_CCOEFF_NORMED);
+        if (use_pyramid) {
+            double threshold = params.templ_thres[std::min(i, params.templ_thres.size() - 1)];
+            matched = coarse_to_fine_match(image, templ, mask, *artifacts, threshold - params.pyramid_tolerance);
         }
         else {
-            cv::Mat mask;
-            cv::cvtColor(params.mask_with_src ? image : templ, mask, cv::COLOR_BGR2GRAY);
-            cv::inRange(mask, params.mask_range.first, params.mask_range.second, mask);
-            if (params.mask_with_close) {
-                cv::Mat kernel = cv::getStructuringElement(cv::MORPH_RECT, cv::Size(3, 3));
-                cv::morphologyEx(mask, mask, cv::MORPH_CLOSE, kernel);
-            }
             cv::matchTemplate(image, templ, matched, cv::TM_CCOEFF_NORMED, mask);
         }
 
@@ -97,3 +129,137 @@ std::vector<Matcher::RawResult> Matcher::preproc_and_match(const cv::Mat& image,
     }
     return results;
 }
+
+std::string Matcher::memo_key(std::string_view analyzer, const MatcherConfig::Params& params)
+{
+    std::string key(analyzer);
+    key += "|templs:";
+    for (const auto& templ : params.templs) {
+        if (!std::holds_alternative<std::string>(templ)) {
+            return {};
+        }
+        key += std::get<std::string>(templ) + ",";
+    }
+    key += ";thres:";
+    for (double thres : params.templ_thres) {
+        key += std::to_string(thres) + ",";
+    }
+    key += ";mask:" + std::to_string(params.mask_range.first) + "," + std::to_string(params.mask_range.second) +
+           (params.mask_with_src ? ",src" : "") + (params.mask_with_close ? ",close" : "");
+    key += ";pyramid:" + std::to_string(params.pyramid_levels) + "," + std::to_string(params.pyramid_tolerance);
+    return key;
+}
+
+cv::Mat Matcher::make_mask(const cv::Mat& src, const MatcherConfig::Params& params, bool src_is_frame)
+{
+    cv::Mat mask;
+    if (src_is_frame) {
+        mask = gray_bin_of(src, params.mask_range.first, params.mask_range.second);
+    }
+    else {
+        cv::cvtColor(src, mask, cv::COLOR_BGR2GRAY);
+        cv::inRange(mask, params.mask_range.first, params.mask_range.second, mask);
+    }
+    if (params.mask_with_close) {
+        // 截图的二值图是共享的，不能原地做闭运算
+        cv::Mat kernel = cv::getStructuringElement(cv::MORPH_RECT, cv::Size(3, 3));
+        cv::Mat closed;
+        cv::morphologyEx(mask, closed, cv::MORPH_CLOSE, kernel);
+        mask = closed;
+    }
+    return mask;
+}
+
+std::string Matcher::artifacts_key(const MatcherConfig::Params& params)
+{
+    std::string key = "pyramid:" + std::to_string(params.pyramid_levels);
+    if (!params.mask_with_src && (params.mask_range.first != 0 || params.mask_range.second != 0)) {
+        key += ";mask:" + std::to_string(params.mask_range.first) + "," + std::to_string(params.mask_range.second) +
+               (params.mask_with_close ? ",close" : "");
+    }
+    return key;
+}
+
+TemplArtifacts Matcher::make_templ_artifacts(const cv::Mat& templ, const MatcherConfig::Params& params)
+{
+    // 模板缩得太小就没什么区分度了，粗匹配的候选会多到没有意义
+    constexpr int MinCoarseTemplSize = 8;
+
+    TemplArtifacts artifacts;
+    if (!params.mask_with_src && (params.mask_range.first != 0 || params.mask_range.second != 0)) {
+        artifacts.mask = make_mask(templ, params);
+    }
+
+    artifacts.coarse_templ = templ;
+    artifacts.coarse_mask = artifacts.mask;
+    for (int i = 0; i < params.pyramid_levels; ++i) {
+        const auto& coarse_templ = artifacts.coarse_templ;
+        if (coarse_templ.cols / 2 < MinCoarseTemplSize || coarse_templ.rows / 2 < MinCoarseTemplSize) {
+            break;
+        }
+        cv::pyrDown(artifacts.coarse_templ, artifacts.coarse_templ);
+        if (!artifacts.coarse_mask.empty()) {
+            cv::resize(artifacts.coarse_mask, artifacts.coarse_mask, artifacts.coarse_templ.size(), 0, 0,
+                       cv::INTER_NEAREST);
+        }
+        artifacts.coarse_scale *= 2;
+    }
+    return artifacts;
+}
+
+cv::Mat Matcher::coarse_to_fine_match(const cv::Mat& image, const cv::Mat& templ, const cv::Mat& mask,
+                                      const TemplArtifacts& artifacts, double candidate_thres)
+{
+    const int scale = artifacts.coarse_scale;
+
+    cv::Mat matched;
+    if (scale == 1) {
+        cv::matchTemplate(image, templ, matched, cv::TM_CCOEFF_NORMED, mask);
+        return matched;
+    }
+
+    int levels = 0;
+    for (int s = 1; s < scale; s *= 2) {
+        ++levels;
+    }
+    // 同一个 roi 下多个模板共用同一份下采样的截图
+    cv::Mat coarse_image = pyr_down_of(image, levels);
+
+    cv::Mat coarse_matched;
+    cv::matchTemplate(coarse_image, artifacts.coarse_templ, coarse_matched, cv::TM_CCOEFF_NORMED,
+                      artifacts.coarse_mask);
+
+    cv::Mat candidates = coarse_matched >= candidate_thres;
+    const int candidates_count = cv::countNonZero(candidates);
+    // 候选太多的话，逐块精匹配反而比直接整图匹配慢
+    if (candidates_count * 4 > static_cast<int>(coarse_matched.total())) {
+        cv::matchTemplate(image, templ, matched, cv::TM_CCOEFF_NORMED, mask);
+        return matched;
+    }
+
+    matched = cv::Mat::zeros(image.rows - templ.rows + 1, image.cols - templ.cols + 1, CV_32FC1);
+    if (candidates_count == 0) {
+        return matched;
+    }
+
+    // 粗匹配的一个点对应原图中 scale * scale 的区域，再向外扩一圈，容纳下采样带来的偏差
+    const cv::Rect matched_rect(0, 0, matched.cols, matched.rows);
+    cv::Mat refine_mask = cv::Mat::zeros(matched.size(), CV_8UC1);
+    std::vector<cv::Point> points;
+    cv::findNonZero(candidates, points);
+    for (const cv::Point& p : points) {
+        cv::Rect window((p.x - 1) * scale, (p.y - 1) * scale, 3 * scale, 3 * scale);
+        cv::rectangle(refine_mask, window & matched_rect, cv::Scalar(255), cv::FILLED);
+    }
+
+    std::vector<std::vector<cv::Point>> contours;
+    cv::findContours(refine_mask, contours, cv::RETR_EXTERNAL, cv::CHAIN_APPROX_SIMPLE);
+    for (const auto& contour : contours) {
+        cv::Rect window = cv::boundingRect(contour);
+        cv::Rect image_window(window.x, window.y, window.width + templ.cols - 1, window.height + templ.rows - 1);
+        cv::Mat window_matched;
+        cv::matchTemplate(image(image_window), templ, window_matched, cv::TM_CCOEFF_NORMED, mask);
+        window_matched.copyTo(matched(window));
+    }
+    return matched;
+}
@@ -1,6 +1,7 @@
 #pragma once
 #include "VisionHelper.h"
 
+#include "Config/TemplResource.h"
 #include "Vision/Config/MatcherConfig.h"
 
 namespace asst
@@ -27,10 +28,21 @@ namespace asst
             std::string templ_name;
         };
         static std::vector<RawResult> preproc_and_match(const cv::Mat& image, const MatcherConfig::Params& params);
+        // 帧内结果备忘的键，包含所有会影响匹配结果的参数；模板不是按名字给的（没法比较）时返回空串，即不备忘
+        static std::string memo_key(std::string_view analyzer, const MatcherConfig::Params& params);
 
     protected:
         virtual void _set_roi(const Rect& roi) override { set_roi(roi); }
 
+        // src_is_frame: src 是截图（的 roi），可以复用同一帧的二值图缓存；模板不要走缓存
+        static cv::Mat make_mask(const cv::Mat& src, const MatcherConfig::Params& params, bool src_is_frame = false);
+        // 模板派生数据的缓存键，只包含会影响派生数据的参数
+        static std::string artifacts_key(const MatcherConfig::Params& params);
+        static TemplArtifacts make_templ_artifacts(const cv::Mat& templ, const MatcherConfig::Params& params);
+        // 由粗到精匹配：返回与原图匹配同样大小的结果，只有候选位置附近有得分，其余位置为 0
+        static cv::Mat coarse_to_fine_match(const cv::Mat& image, const cv::Mat& templ, const cv::Mat& mask,
+                                            const TemplArtifacts& artifacts, double candidate_thres);
+
     private:
         // FIXME: 老接口太难重构了，先弄个这玩意兼容下，后续慢慢全删掉
         mutable Result m_result;
@@ -135,22 +135,31 @@ bool asst::OperBoxImageAnalyzer::level_analyze()
     const auto& ocr_replace_num = Task.get<OcrTaskInfo>("NumberOcrReplace");
     level_analyzer.set_replace(ocr_replace_num->replace_map, ocr_replace_num->replace_full);
 
-    for (auto& box : m_result) {
+    std::vector<Rect> rois;
+    rois.reserve(m_result.size());
+    for (const auto& box : m_result) {
         Rect roi = box.rect.move(level_roi);
         if (roi.x < 0) {
             // 等级在lv的左,lv的识别框x该右移
             Log.error("level roi", roi, "is out of range");
             return false;
         }
-        level_analyzer.set_roi(roi);
-        if (!level_analyzer.analyze()) {
+        rois.emplace_back(roi);
+    }
+
+    // 一屏的等级一次性批量识别
+    auto ocr_results = level_analyzer.analyze_batch(rois);
+    for (size_t i = 0; i != m_result.size(); ++i) {
+        auto& box = m_result[i];
+        if (!ocr_results[i]) {
             box.level = 1;
             continue;
         }
-        const auto& ocr_result = level_analyzer.get_result();
+        const auto& ocr_result = *ocr_results[i];
         const std::string& level = ocr_result.text;
         box.level = level_num(level);
 #ifdef ASST_DEBUG
+        const Rect& roi = rois[i];
         cv::rectangle(m_image_draw, make_rect<cv::Rect>(ocr_result.rect), cv::Scalar(0, 255, 0), 1);
         cv::putText(m_image_draw, level, cv::Point(roi.x, roi.y - 10), cv::FONT_HERSHEY_SIMPLEX, 0.5,
                     cv::Scalar(0, 0, 255), 2);
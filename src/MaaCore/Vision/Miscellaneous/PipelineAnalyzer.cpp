@@ -1,11 +1,15 @@
 #include "PipelineAnalyzer.h"
 
+#include <atomic>
+#include <chrono>
+#include <future>
 #include <regex>
 #include <utility>
 
 #include "Config/TaskData.h"
 #include "Status.h"
 #include "Utils/Logger.hpp"
+#include "Utils/WorkerPool.hpp"
 #include "Vision/Matcher.h"
 #include "Vision/OCRer.h"
 #include "Vision/RegionOCRer.h"
@@ -14,8 +18,10 @@ using namespace asst;
 
 PipelineAnalyzer::ResultOpt PipelineAnalyzer::analyze() const
 {
+    std::vector<std::shared_ptr<TaskInfo>> tasks;
+    tasks.reserve(m_tasks_name.size());
     for (const std::string& task_name : m_tasks_name) {
-        const auto& task_ptr = Task.get(task_name);
+        auto task_ptr = Task.get(task_name);
         // 可能有配置错误，导致不存在对应的任务
         if (task_ptr == nullptr) {
             Log.error("Invalid task", task_name);
@@ -24,7 +30,14 @@ PipelineAnalyzer::ResultOpt PipelineAnalyzer::analyze() const
 #endif
             continue;
         }
+        tasks.emplace_back(std::move(task_ptr));
+    }
+
+    if (m_threads > 1) {
+        return analyze_parallel(tasks);
+    }
 
+    for (const auto& task_ptr : tasks) {
         Log.trace(__FUNCTION__, task_ptr->name);
         switch (task_ptr->algorithm) {
         case AlgorithmType::JustReturn: {
@@ -48,26 +61,113 @@ PipelineAnalyzer::ResultOpt PipelineAnalyzer::analyze() const
     return std::nullopt;
 }
 
-Matcher::ResultOpt PipelineAnalyzer::match(const std::shared_ptr<TaskInfo>& task_ptr) const
+PipelineAnalyzer::ResultOpt PipelineAnalyzer::analyze_parallel(const std::vector<std::shared_ptr<TaskInfo>>& tasks) const
 {
-    Matcher match_analyzer(m_image, m_roi);
+    // 只有模板匹配放到工作线程里做；OCR 模型不支持并发调用，status 也不是线程安全的，
+    // 所以 OCR 和缓存的读写都留在当前线程，按任务顺序进行
+    const size_t tasks_size = tasks.size();
+    std::vector<std::shared_ptr<MatchTaskInfo>> match_tasks(tasks_size);
+    std::vector<std::optional<Rect>> cache_rois(tasks_size);
+    std::vector<std::promise<Matcher::ResultOpt>> match_promises(tasks_size);
+    std::vector<std::future<Matcher::ResultOpt>> match_futures(tasks_size);
+    std::vector<size_t> match_indices;
+
+    for (size_t i = 0; i < tasks_size; ++i) {
+        if (tasks[i]->algorithm != AlgorithmType::MatchTemplate) {
+            continue;
+        }
+        match_tasks[i] = std::dynamic_pointer_cast<MatchTaskInfo>(tasks[i]);
+        if (m_inst && match_tasks[i]->cache) {
+            cache_rois[i] = status()->get_rect(match_tasks[i]->name);
+        }
+        match_futures[i] = match_promises[i].get_future();
+        match_indices.emplace_back(i);
+    }
 
-    const auto match_task_ptr = std::dynamic_pointer_cast<MatchTaskInfo>(task_ptr);
-    if (ranges::all_of(match_task_ptr->templ_thresholds, [](double t) { return t > 1.0; })) {
-        Log.info(match_task_ptr->name, "'s threshold is", match_task_ptr->templ_thresholds, ", just skip");
-        return std::nullopt;
+    // 已知命中的任务中最靠前的下标，排在它后面的任务不可能被选中，不用再识别了
+    std::atomic_size_t hit_index = tasks_size;
+    auto update_hit_index = [&](size_t index) {
+        size_t cur = hit_index.load();
+        while (index < cur && !hit_index.compare_exchange_weak(cur, index)) {
+        }
+    };
+
+    // 按任务顺序领取，当前线程等某个任务的结果时也会顺手领下一个来做，池里的线程都忙的时候不会干等
+    auto batch = WorkerPool::get_instance().parallel(
+        match_indices.size(), static_cast<size_t>(m_threads - 1), [&](size_t n) {
+            const size_t index = match_indices[n];
+            if (index > hit_index) {
+                match_promises[index].set_value(std::nullopt);
+                return;
+            }
+            try {
+                auto match_opt = match_without_cache(match_tasks[index], cache_rois[index]);
+                if (match_opt) {
+                    update_hit_index(index);
+                }
+                match_promises[index].set_value(std::move(match_opt));
+            }
+            catch (...) {
+                match_promises[index].set_exception(std::current_exception());
+            }
+        });
+
+    ResultOpt result;
+    try {
+        for (size_t i = 0; i < tasks_size && !result; ++i) {
+            const auto& task_ptr = tasks[i];
+            Log.trace(__FUNCTION__, task_ptr->name);
+            switch (task_ptr->algorithm) {
+            case AlgorithmType::JustReturn: {
+                result = Result { .task_ptr = task_ptr };
+            } break;
+
+            case AlgorithmType::MatchTemplate:
+                while (match_futures[i].wait_for(std::chrono::seconds(0)) != std::future_status::ready &&
+                       batch->run_next()) {
+                }
+                if (auto match_opt = match_futures[i].get()) {
+                    if (m_inst && match_tasks[i]->cache) {
+                        status()->set_rect(task_ptr->name, match_opt->rect);
+                    }
+                    result = Result { .task_ptr = task_ptr, .result = *match_opt, .rect = match_opt->rect };
+                }
+                break;
+            case AlgorithmType::OcrDetect:
+                if (auto ocr_opt = ocr(task_ptr)) {
+                    result = Result { .task_ptr = task_ptr, .result = ocr_opt->front(), .rect = ocr_opt->front().rect };
+                }
+                break;
+            default:
+                break;
+            }
+            if (result) {
+                update_hit_index(i);
+            }
+        }
     }
-    match_analyzer.set_task_info(match_task_ptr);
+    catch (...) {
+        // 工作线程引用了这里的局部变量，抛出去之前也得等它们做完
+        batch->wait();
+        throw;
+    }
+
+    // 工作线程引用了这里的局部变量，必须等它们手上的做完；剩下的低优先级任务会被直接跳过
+    batch->wait();
+    return result;
+}
+
+Matcher::ResultOpt PipelineAnalyzer::match(const std::shared_ptr<TaskInfo>& task_ptr) const
+{
+    const auto match_task_ptr = std::dynamic_pointer_cast<MatchTaskInfo>(task_ptr);
 
     bool use_cache = m_inst && match_task_ptr->cache;
+    std::optional<Rect> cache_opt;
     if (use_cache) {
-        auto cache_opt = status()->get_rect(match_task_ptr->name);
-        if (cache_opt) {
-            match_analyzer.set_roi(*cache_opt);
-        }
+        cache_opt = status()->get_rect(match_task_ptr->name);
     }
 
-    const auto& result_opt = match_analyzer.analyze();
+    auto result_opt = match_without_cache(match_task_ptr, cache_opt);
 
     if (!result_opt) {
         return std::nullopt;
@@ -79,6 +179,23 @@ Matcher::ResultOpt PipelineAnalyzer::match(const std::shared_ptr<TaskInfo>& task
     return result_opt;
 }
 
+Matcher::ResultOpt PipelineAnalyzer::match_without_cache(const std::shared_ptr<MatchTaskInfo>& match_task_ptr,
+                                                         const std::optional<Rect>& cache_roi) const
+{
+    if (ranges::all_of(match_task_ptr->templ_thresholds, [](double t) { return t > 1.0; })) {
+        Log.info(match_task_ptr->name, "'s threshold is", match_task_ptr->templ_thresholds, ", just skip");
+        return std::nullopt;
+    }
+
+    Matcher match_analyzer(m_image, m_roi);
+    match_analyzer.set_task_info(match_task_ptr);
+    if (cache_roi) {
+        match_analyzer.set_roi(*cache_roi);
+    }
+
+    return match_analyzer.analyze();
+}
+
 OCRer::ResultsVecOpt PipelineAnalyzer::ocr(const std::shared_ptr<TaskInfo>& task_ptr) const
 {
     const auto ocr_task_ptr = std::dynamic_pointer_cast<OcrTaskInfo>(task_ptr);
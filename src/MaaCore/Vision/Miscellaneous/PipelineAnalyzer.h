@@ -28,13 +28,21 @@ namespace asst
         virtual ~PipelineAnalyzer() override = default;
 
         void set_tasks(std::vector<std::string> tasks_name) { m_tasks_name = std::move(tasks_name); }
+        // 大于 1 时，模板匹配的任务会在多个线程中并行识别，结果仍按任务列表的顺序取第一个命中的
+        void set_threads(int threads) noexcept { m_threads = threads; }
 
         ResultOpt analyze() const;
 
     private:
+        ResultOpt analyze_parallel(const std::vector<std::shared_ptr<TaskInfo>>& tasks) const;
+
         Matcher::ResultOpt match(const std::shared_ptr<TaskInfo>& task_ptr) const;
+        // 不读写 status 中的缓存，可以在工作线程中调用
+        Matcher::ResultOpt match_without_cache(const std::shared_ptr<MatchTaskInfo>& match_task_ptr,
+                                               const std::optional<Rect>& cache_roi) const;
         OCRer::ResultsVecOpt ocr(const std::shared_ptr<TaskInfo>& task_ptr) const;
 
         std::vector<std::string> m_tasks_name;
+        int m_threads = 1;
     };
 }
@@ -141,8 +141,7 @@ bool asst::StageDropsImageAnalyzer::analyze_difficulty()
     }
 
     cv::Mat image_roi = m_image(make_rect<cv::Rect>(analyzed->rect));
-    cv::Mat hsv;
-    cv::cvtColor(image_roi, hsv, cv::COLOR_BGR2HSV);
+    cv::Mat hsv = hsv_of(image_roi);
 
     cv::Mat bin1;
     cv::inRange(hsv, cv::Scalar(0, 150, 100), cv::Scalar(2, 255, 255), bin1);
@@ -536,8 +535,7 @@ std::optional<asst::TextRect> asst::StageDropsImageAnalyzer::match_quantity_stri
     Rect quantity_roi = roi.move(task_ptr->roi);
     cv::Mat quantity_img = m_image(make_rect<cv::Rect>(quantity_roi));
 
-    cv::Mat gray;
-    cv::cvtColor(quantity_img, gray, cv::COLOR_BGR2GRAY);
+    cv::Mat gray = gray_of(quantity_img);
     cv::Mat bin;
     cv::inRange(gray, task_ptr->mask_range.first, task_ptr->mask_range.second, bin);
 
@@ -586,6 +584,7 @@ std::optional<asst::TextRect> asst::StageDropsImageAnalyzer::match_quantity_stri
 
     RegionOCRer analyzer(m_image);
     analyzer.set_task_info("NumberOcrReplace");
+    analyzer.set_digit_set("StageDropsQuantity");
     analyzer.set_roi(Rect(quantity_roi.x + far_left, quantity_roi.y, far_right - far_left, quantity_roi.height));
     analyzer.set_bin_threshold(task_ptr->mask_range.first, task_ptr->mask_range.second);
     analyzer.set_use_char_model(!use_word_model);
@@ -653,6 +652,8 @@ std::optional<asst::TextRect> asst::StageDropsImageAnalyzer::match_quantity_stri
 
     RegionOCRer ocr(ocr_img);
     ocr.set_task_info("NumberOcrReplace");
+    // 减掉了物品模板，和上面不是同一种图，样本分开存
+    ocr.set_digit_set("StageDropsQuantityMasked");
     Rect ocr_roi { new_roi.x + mask_rect.x, new_roi.y + mask_rect.y, mask_rect.width, mask_rect.height };
     ocr.set_roi(ocr_roi);
     ocr.set_use_char_model(!use_word_model);
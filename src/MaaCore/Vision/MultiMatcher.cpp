@@ -1,6 +1,6 @@
 #include "MultiMatcher.h"
 
-#include "Utils/Ranges.hpp"
+#include <limits>
 #include <utility>
 
 #include "Utils/NoWarningCV.h"
@@ -14,7 +14,22 @@ using namespace asst;
 
 MultiMatcher::ResultsVecOpt MultiMatcher::analyze() const
 {
-    auto match_results = Matcher::preproc_and_match(make_roi(m_image, m_roi), m_params);
+    const cv::Mat image = make_roi(m_image, m_roi);
+    // 备忘里存的是相对 roi 的坐标
+    const std::string key = Matcher::memo_key("MultiMatcher", m_params);
+    if (auto memo = memo_get<ResultsVec>(image, key)) {
+        if (memo->empty()) {
+            return std::nullopt;
+        }
+        for (Result& res : *memo) {
+            res.rect.x += m_roi.x;
+            res.rect.y += m_roi.y;
+        }
+        m_result = std::move(*memo);
+        return m_result;
+    }
+
+    auto match_results = Matcher::preproc_and_match(image, m_params);
     if (match_results.empty()) {
         return std::nullopt;
     }
@@ -28,39 +43,76 @@ MultiMatcher::ResultsVecOpt MultiMatcher::analyze() const
     std::vector<Result> results;
     double threshold = m_params.templ_thres.front();
 
+    // 一次性取出所有超过阈值的点，inRange 顺带排除了 nan 和 inf；findNonZero 按行优先的顺序返回
+    cv::Mat candidates_mask;
+    cv::inRange(matched, threshold, std::numeric_limits<float>::max(), candidates_mask);
+    std::vector<cv::Point> candidates;
+    cv::findNonZero(candidates_mask, candidates);
+
     int min_distance = (std::min)(templ.cols, templ.rows) / 2;
-    for (int i = 0; i != matched.rows; ++i) {
-        for (int j = 0; j != matched.cols; ++j) {
-            auto value = matched.at<float>(i, j);
-            if (value < threshold || std::isnan(value) || std::isinf(value)) {
-                continue;
-            }
+    // 按 min_distance 分格，离得太近的两个点一定在相邻的格子里，不用再遍历全部结果
+    const int cell_size = (std::max)(min_distance, 1);
+    const int grid_cols = matched.cols / cell_size + 1;
+    const int grid_rows = matched.rows / cell_size + 1;
+    std::vector<std::vector<size_t>> grid(static_cast<size_t>(grid_cols) * grid_rows);
+    std::vector<cv::Point> result_points;
+    auto cell_of = [&](const cv::Point& p) -> std::vector<size_t>& {
+        return grid[static_cast<size_t>(p.y / cell_size) * grid_cols + p.x / cell_size];
+    };
 
-            Rect rect(j + m_roi.x, i + m_roi.y, templ.cols, templ.rows);
-            bool need_push = true;
-            // 如果有两个点离得太近，只取里面得分高的那个
-            // 一般相邻的都是刚刚push进去的，这里倒序快一点
-            for (auto& iter : ranges::reverse_view(results)) {
-                if (std::abs(j + m_roi.x - iter.rect.x) >= min_distance ||
-                    std::abs(i + m_roi.y - iter.rect.y) >= min_distance) {
-                    continue;
-                }
+    for (const cv::Point& p : candidates) {
+        auto value = matched.at<float>(p);
+        if (value < threshold) { // inRange 是按 float 比较的，阈值转成 float 后可能略小一点
+            continue;
+        }
 
-                if (iter.score < value) {
-                    iter.rect = rect;
-                    iter.score = value;
-                } // else 这个点就放弃了
-                need_push = false;
-                break;
-            }
-            if (need_push) {
-                Result tmp;
-                tmp.rect = rect;
-                tmp.score = value;
-                results.emplace_back(std::move(tmp));
+        // 如果有两个点离得太近，只取里面得分高的那个
+        // 与原先倒序遍历的结果保持一致：离得近的结果里取最后加入的那个
+        constexpr size_t NotFound = std::numeric_limits<size_t>::max();
+        size_t nearest = NotFound;
+        const int cell_x = p.x / cell_size;
+        const int cell_y = p.y / cell_size;
+        for (int y = (std::max)(cell_y - 1, 0); y <= (std::min)(cell_y + 1, grid_rows - 1); ++y) {
+            for (int x = (std::max)(cell_x - 1, 0); x <= (std::min)(cell_x + 1, grid_cols - 1); ++x) {
+                for (size_t index : grid[static_cast<size_t>(y) * grid_cols + x]) {
+                    const cv::Point& rp = result_points[index];
+                    if (std::abs(p.x - rp.x) >= min_distance || std::abs(p.y - rp.y) >= min_distance) {
+                        continue;
+                    }
+                    if (nearest == NotFound || index > nearest) {
+                        nearest = index;
+                    }
+                }
             }
         }
+
+        Rect rect(p.x + m_roi.x, p.y + m_roi.y, templ.cols, templ.rows);
+        if (nearest == NotFound) {
+            Result tmp;
+            tmp.rect = rect;
+            tmp.score = value;
+            cell_of(p).emplace_back(results.size());
+            result_points.emplace_back(p);
+            results.emplace_back(std::move(tmp));
+            continue;
+        }
+
+        auto& iter = results[nearest];
+        if (iter.score < value) {
+            std::erase(cell_of(result_points[nearest]), nearest);
+            cell_of(p).emplace_back(nearest);
+            result_points[nearest] = p;
+            iter.rect = rect;
+            iter.score = value;
+        } // else 这个点就放弃了
+    }
+
+    ResultsVec memo = results;
+    for (Result& res : memo) {
+        res.rect.x -= m_roi.x;
+        res.rect.y -= m_roi.y;
     }
+    memo_set(image, key, std::move(memo));
 
     if (results.empty()) {
         return std::nullopt;
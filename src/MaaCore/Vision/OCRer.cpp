@@ -1,17 +1,48 @@
 #include "OCRer.h"
 
-#include <regex>
 #include <unordered_map>
 
 #include "Config/Miscellaneous/OcrConfig.h"
 #include "Config/Miscellaneous/OcrPack.h"
 #include "Config/TaskData.h"
 #include "Utils/Logger.hpp"
+#include "Vision/DigitRecognizer.h"
 
 using namespace asst;
 
 OCRer::ResultsVecOpt OCRer::analyze() const
 {
+    const cv::Mat image = make_roi(m_image, m_roi);
+    // 备忘的是后处理之前的原始结果，替换、required 这些参数不同也能共用
+    std::string key = std::string("OCRer|") + (m_params.use_char_model ? "char" : "word") +
+                      (m_params.without_det ? ",without_det" : "");
+    if (use_digit_recognizer()) {
+        key += ",digit:" + m_params.digit_set + "," + std::to_string(m_params.bin_threshold_lower) + "," +
+               std::to_string(m_params.bin_threshold_upper);
+    }
+    ResultsVec raw_results;
+    if (auto memo = memo_get<ResultsVec>(image, key)) {
+        raw_results = std::move(*memo);
+    }
+    else {
+        raw_results = recognize(image);
+        memo_set(image, key, raw_results);
+    }
+
+    return postprocess(std::move(raw_results));
+}
+
+OCRer::ResultsVec OCRer::recognize(const cv::Mat& image) const
+{
+    auto& digit_recognizer = DigitRecognizer::get_instance();
+    if (use_digit_recognizer()) {
+        if (auto digit_result = digit_recognizer.recognize(m_params.digit_set, image, m_params.bin_threshold_lower,
+                                                           m_params.bin_threshold_upper)) {
+            Log.trace("DigitRecognizer", *digit_result);
+            return { std::move(*digit_result) };
+        }
+    }
+
     OcrPack* ocr_ptr = nullptr;
     if (m_params.use_char_model) {
         ocr_ptr = &CharOcr::get_instance();
@@ -19,10 +50,19 @@ OCRer::ResultsVecOpt OCRer::analyze() const
     else {
         ocr_ptr = &WordOcr::get_instance();
     }
-    ResultsVec raw_results = ocr_ptr->recognize(make_roi(m_image, m_roi), m_params.without_det);
+    ResultsVec raw_results = ocr_ptr->recognize(image, m_params.without_det, m_params.use_cache);
     ocr_ptr = nullptr;
 
-    /* post process */
+    // 数字识别认不出来的，用 OCR 的结果教它
+    if (use_digit_recognizer() && raw_results.size() == 1) {
+        digit_recognizer.learn(m_params.digit_set, image, m_params.bin_threshold_lower, m_params.bin_threshold_upper,
+                               raw_results.front().text, raw_results.front().score);
+    }
+    return raw_results;
+}
+
+OCRer::ResultsVecOpt OCRer::postprocess(ResultsVec raw_results) const
+{
     ResultsVec results_vec;
     for (Result& res : raw_results) {
         if (res.text.empty() || std::isnan(res.score) || std::isinf(res.score)) {
@@ -75,39 +115,28 @@ void OCRer::postproc_equivalence_(Result& res) const
 
 void OCRer::postproc_replace_(Result& res) const
 {
-    if (m_params.replace.empty()) {
+    if (!m_params.replace) {
         return;
     }
 
-    for (const auto& [regex, new_str] : m_params.replace) {
-        if (m_params.replace_full) {
-            if (std::regex_search(res.text, std::regex(regex))) {
-                res.text = new_str;
-            }
-        }
-        else {
-            res.text = std::regex_replace(res.text, std::regex(regex), new_str);
-        }
-    }
+    m_params.replace->apply(res.text, m_params.replace_full);
 }
 
 bool OCRer::filter_and_replace_by_required_(Result& res) const
 {
-    if (m_params.required.empty()) {
+    if (!m_params.required || m_params.required->empty()) {
         return true;
     }
 
     if (m_params.full_match) {
-        return ranges::find(m_params.required, res.text) != m_params.required.cend();
+        return m_params.required->contains(res.text);
     }
     else {
-        auto is_sub = [&res](const std::string& str) -> bool {
-            if (res.text.find(str) == std::string::npos) {
-                return false;
-            }
-            res.text = str;
-            return true;
-        };
-        return ranges::find_if(m_params.required, is_sub) != m_params.required.cend();
+        const std::string* matched = m_params.required->first_substring_of(res.text);
+        if (!matched) {
+            return false;
+        }
+        res.text = *matched;
+        return true;
     };
 }
@@ -19,6 +19,8 @@ namespace asst
         virtual ~OCRer() override = default;
 
         ResultsVecOpt analyze() const;
+        // 对 OcrPack 的原始结果做后处理（roi 偏移、替换、required 过滤等），供批量识别复用
+        ResultsVecOpt postprocess(ResultsVec raw_results) const;
         // FIXME: 老接口太难重构了，先弄个这玩意兼容下，后续慢慢全删掉
         const auto& get_result() const noexcept { return m_result; }
 
@@ -31,6 +33,10 @@ namespace asst
         using OCRerConfig::set_bin_trim_threshold;
 
     protected:
+        // 识别 roi 内的原始结果：开启了数字识别时先试 DigitRecognizer，认不出来再用 OCR
+        ResultsVec recognize(const cv::Mat& image) const;
+        bool use_digit_recognizer() const noexcept { return m_params.without_det && !m_params.digit_set.empty(); }
+
         void postproc_rect_(Result& res) const;
         void postproc_trim_(Result& res) const;
         void postproc_equivalence_(Result& res) const;
@@ -15,20 +15,18 @@ namespace asst
         {
             T output = input;
             float rowmax = *std::max_element(output.begin(), output.end());
-            std::vector<float> y(output.size());
             float sum = 0.0f;
-            for (size_t i = 0; i != output.size(); ++i) {
-                sum += y[i] = std::exp(output[i] - rowmax);
+            for (auto& val : output) {
+                sum += val = std::exp(val - rowmax);
             }
-            for (size_t i = 0; i != output.size(); ++i) {
-                output[i] = y[i] / sum;
+            for (auto& val : output) {
+                val /= sum;
             }
             return output;
         }
 
         static std::vector<float> image_to_tensor(const cv::Mat& image);
-
-    private:
-        static cv::Mat hwc_to_chw(const cv::Mat& src);
+        // BGR 的 HWC 图像一遍转成 RGB 的 CHW 浮点数据并归一化，直接写到 dst 里（需要 3 * rows * cols 的空间）
+        static void image_to_tensor(const cv::Mat& image, float* dst);
     };
 }
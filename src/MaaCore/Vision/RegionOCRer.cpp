@@ -6,9 +6,73 @@ using namespace asst;
 
 RegionOCRer::ResultOpt RegionOCRer::analyze() const
 {
-    cv::Mat img_roi = make_roi(m_image, m_roi);
-    cv::Mat img_roi_gray;
-    cv::cvtColor(img_roi, img_roi_gray, cv::COLOR_BGR2GRAY);
+    auto new_roi = text_roi(m_roi);
+    if (!new_roi) {
+        return std::nullopt;
+    }
+
+    OCRer ocr_analyzer(m_image, *new_roi);
+    auto config = m_params;
+    config.without_det = true;
+    ocr_analyzer.set_params(std::move(config));
+
+    auto result = ocr_analyzer.analyze();
+    if (!result) {
+        return std::nullopt;
+    }
+    m_result = result->front();
+    return m_result;
+}
+
+std::vector<RegionOCRer::ResultOpt> RegionOCRer::analyze_batch(const std::vector<Rect>& rois) const
+{
+    std::vector<ResultOpt> results(rois.size());
+
+    std::vector<size_t> valid_indices;
+    std::vector<Rect> text_rois;
+    std::vector<cv::Mat> images;
+    for (size_t i = 0; i != rois.size(); ++i) {
+        auto new_roi = text_roi(rois[i]);
+        if (!new_roi) {
+            continue;
+        }
+        valid_indices.emplace_back(i);
+        text_rois.emplace_back(*new_roi);
+        images.emplace_back(make_roi(m_image, *new_roi));
+    }
+    if (images.empty()) {
+        return results;
+    }
+
+    OcrPack* ocr_ptr = nullptr;
+    if (m_params.use_char_model) {
+        ocr_ptr = &CharOcr::get_instance();
+    }
+    else {
+        ocr_ptr = &WordOcr::get_instance();
+    }
+    OcrPack::ResultsVec raw_results = ocr_ptr->recognize_batch(images, m_params.use_cache);
+    if (raw_results.size() != images.size()) {
+        return results;
+    }
+
+    auto config = m_params;
+    config.without_det = true;
+    for (size_t i = 0; i != raw_results.size(); ++i) {
+        OCRer ocr_analyzer(m_image, text_rois[i]);
+        ocr_analyzer.set_params(config);
+        auto result = ocr_analyzer.postprocess({ std::move(raw_results[i]) });
+        if (result) {
+            results[valid_indices[i]] = result->front();
+        }
+    }
+    return results;
+}
+
+std::optional<Rect> RegionOCRer::text_roi(const Rect& roi) const
+{
+    cv::Mat img_roi = make_roi(m_image, roi);
+    cv::Mat img_roi_gray = gray_of(img_roi);
     cv::Mat bin;
     cv::inRange(img_roi_gray, m_params.bin_threshold_lower, m_params.bin_threshold_upper, bin);
 
@@ -16,8 +80,8 @@ RegionOCRer::ResultOpt RegionOCRer::analyze() const
     bin_right_trim(bin);
 
     cv::Rect bounding_rect = cv::boundingRect(bin);
-    bounding_rect.x += m_roi.x;
-    bounding_rect.y += m_roi.y;
+    bounding_rect.x += roi.x;
+    bounding_rect.y += roi.y;
     auto new_roi = make_rect<Rect>(bounding_rect);
 
     if (new_roi.empty()) {
@@ -36,17 +100,7 @@ RegionOCRer::ResultOpt RegionOCRer::analyze() const
     cv::rectangle(m_image_draw, make_rect<cv::Rect>(new_roi), cv::Scalar(0, 0, 255), 1);
 #endif // ASST_DEBUG
 
-    OCRer ocr_analyzer(m_image, new_roi);
-    auto config = m_params;
-    config.without_det = true;
-    ocr_analyzer.set_params(std::move(config));
-
-    auto result = ocr_analyzer.analyze();
-    if (!result) {
-        return std::nullopt;
-    }
-    m_result = result->front();
-    return m_result;
+    return new_roi;
 }
 
 void asst::RegionOCRer::bin_left_trim(cv::Mat& bin) const
@@ -14,6 +14,8 @@ namespace asst
         virtual ~RegionOCRer() override = default;
 
         ResultOpt analyze() const;
+        // 对多个 roi 分别做二值化裁剪后一次性批量识别，返回值与 rois 一一对应
+        std::vector<ResultOpt> analyze_batch(const std::vector<Rect>& rois) const;
         // FIXME: 老接口太难重构了，先弄个这玩意兼容下，后续慢慢全删掉
         const auto& get_result() const noexcept { return m_result; }
 
@@ -21,6 +23,7 @@ namespace asst
         using OCRerConfig::set_without_det;
         virtual void _set_roi(const Rect& roi) override { set_roi(roi); }
 
+        std::optional<Rect> text_roi(const Rect& roi) const;
         void bin_left_trim(cv::Mat& bin) const;
         void bin_right_trim(cv::Mat& bin) const;
 
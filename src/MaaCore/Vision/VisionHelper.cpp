@@ -91,3 +91,23 @@ bool VisionHelper::save_img(const std::filesystem::path& relative_dir)
 
     return ret;
 }
+
+cv::Mat VisionHelper::gray_of(const cv::Mat& image)
+{
+    return FrameCache::get_instance().gray(image);
+}
+
+cv::Mat VisionHelper::hsv_of(const cv::Mat& image)
+{
+    return FrameCache::get_instance().hsv(image);
+}
+
+cv::Mat VisionHelper::gray_bin_of(const cv::Mat& image, int lower, int upper)
+{
+    return FrameCache::get_instance().gray_bin(image, lower, upper);
+}
+
+cv::Mat VisionHelper::pyr_down_of(const cv::Mat& image, int levels)
+{
+    return FrameCache::get_instance().pyr_down(image, levels);
+}
@@ -2,6 +2,7 @@
 
 #include "Common/AsstTypes.h"
 #include "InstHelper.h"
+#include "Vision/FrameCache.h"
 #include "Utils/NoWarningCVMat.h"
 #include "Utils/Platform.hpp"
 #include "Utils/Ranges.hpp"
@@ -42,6 +43,26 @@ namespace asst
     protected:
         static Rect correct_rect(const Rect& rect, const cv::Mat& image);
 
+        // 同一帧截图的派生图在所有识别器间共享，见 FrameCache。返回的图不要原地修改
+        static cv::Mat gray_of(const cv::Mat& image);
+        static cv::Mat hsv_of(const cv::Mat& image);
+        static cv::Mat gray_bin_of(const cv::Mat& image, int lower, int upper);
+        static cv::Mat pyr_down_of(const cv::Mat& image, int levels);
+
+        // 同一帧、同一 roi、同样参数的识别结果只算一次，见 FrameCache::get_result
+        template <typename T>
+        static std::optional<T> memo_get(const cv::Mat& image, const std::string& key)
+        {
+            return key.empty() ? std::nullopt : FrameCache::get_instance().get_result<T>(image, key);
+        }
+        template <typename T>
+        static void memo_set(const cv::Mat& image, const std::string& key, T value)
+        {
+            if (!key.empty()) {
+                FrameCache::get_instance().set_result(image, key, std::move(value));
+            }
+        }
+
         cv::Mat m_image;
 #ifdef ASST_DEBUG
         cv::Mat m_image_draw;
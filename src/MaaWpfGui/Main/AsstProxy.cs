@@ -2187,5 +2187,10 @@ namespace MaaWpfGui.Main
         /// Indicates whether the ADB server process should be killed when the instance is exited.
         /// </summary>
         KillAdbOnExit = 5,
+
+        /// <summary>
+        /// Indicates whether screenshots are continuously captured by a background thread.
+        /// </summary>
+        ContinuousScreencap = 6,
     }
 }